@@ -0,0 +1,67 @@
+/****************************************************************************************************************************
+  AdaptivePolling_ESP8266.ino - Poll the boiler temperature of an EGO Smart Heater only as often as needed with an ESP8266
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// EGO Smart Heater control
+#define DERE_PIN D1     // DE and RE Pin
+#define ENERGY_RX_PIN D2  // RO Pin
+#define ENERGY_TX_PIN D3  // DI Pin
+
+#include <SoftwareSerial.h>
+// use SW-serial, since ESP does not provide additional HW serial interfaces
+SoftwareSerial swSerial;
+#include <EgoSmartHeaterRS485.h>
+#include <EgoSmartHeaterPollScheduler.h>
+//Initialize the EGO SmartHeater instance with the DE-RE pin number
+EgoSmartHeaterRS485 Heater(DERE_PIN);
+EgoSmartHeaterPollScheduler Scheduler;
+
+unsigned long LastActivation = 0;
+
+void setup() {
+  Serial.begin(115200);
+
+  // communicate with Modbus slave via SW serial
+  swSerial.begin(EGO_SH_RS485_SERIAL_BAUD, SWSERIAL_8E1, ENERGY_RX_PIN, ENERGY_TX_PIN);
+  Heater.begin(swSerial);
+  delay(5000);
+
+  // poll more often when the boiler gets close to one of the configured temperatures
+  TemperatureConfig_t config = Heater.getTemperatureConfig();
+  Scheduler.setThresholds(config, Heater.getUserTemperatureNominal());
+  Heater.setPowerNominalValue(1500);
+  LastActivation = millis();
+  Scheduler.setRelaisStatus(millis(), Heater.getRelaisStatus());
+}
+
+void loop() {
+  // renew the power nominal value, otherwise the heater turns off after 60 seconds
+  if (millis() - LastActivation >= 30000) {
+    Heater.setPowerNominalValue(1500);
+    LastActivation = millis();
+  }
+
+  if (!Scheduler.isDue(millis()))
+    return;
+
+  int16_t temperature = Heater.getActualTemperatureBoiler();
+  if (Heater.getErrCode() != 0)
+    return;
+  uint16_t relaisStatus = Heater.getRelaisStatus();
+  if (Heater.getErrCode() != 0)
+    return;
+  Scheduler.update(millis(), temperature, relaisStatus);
+
+  Serial.print("Boiler: ");
+  Serial.print(temperature);
+  Serial.print(" C, heating ");
+  Serial.print(Scheduler.getHeatingRate());
+  Serial.print(" K/h per 500W, cooling ");
+  Serial.print(Scheduler.getCoolingRate());
+  Serial.print(" K/h, next poll in ");
+  Serial.print((Scheduler.getNextPoll() - millis()) / 1000);
+  Serial.println(" s");
+}
@@ -0,0 +1,120 @@
+/****************************************************************************************************************************
+  AllocatorBenchmark.ino - Benchmark of the multi heater power allocator over synthetic surplus profiles
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// No RS485 hardware required, the heaters are simulated in the sketch.
+// The sketch runs one simulated day with one allocation per minute for several surplus profiles and prints
+// the calculation time, the exported energy and the number of relais switching operations.
+
+#include <EgoSmartHeaterAllocator.h>
+
+#define HEATER_COUNT 4
+#define MINUTES_PER_DAY 1440
+
+EgoSmartHeaterAllocator Allocator;
+HeaterAllocationInput_t Heaters[HEATER_COUNT];
+HeaterAllocation_t Result[HEATER_COUNT];
+uint32_t LockedUntil[HEATER_COUNT][3];
+uint32_t Seed = 1;
+
+// simple linear congruential generator, keeps the profiles reproducible on every platform
+uint16_t random16() {
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 16) & 0x7FFF;
+}
+
+// surplus in Watts at the given minute of the day, cloudiness 0 (clear sky) .. 100 (heavy clouds)
+int32_t surplusProfile(int minute, int peak, int cloudiness) {
+  if (minute < 360 || minute > 1200)
+    return 0;
+  // parabola between 6:00 and 20:00
+  int32_t x = minute - 780;
+  int32_t p = (int32_t)peak - (int32_t)peak * x * x / (420L * 420L);
+  if (cloudiness > 0 && (int)(random16() % 100) < cloudiness)
+    p = p * (random16() % 100) / 100;
+  return p - 400; // base load of the home
+}
+
+void resetHeaters() {
+  for (int h = 0; h < HEATER_COUNT; h++) {
+    Heaters[h].TemperatureBoiler = 40 + 5 * h;
+    Heaters[h].TemperatureMaxValue = 65;
+    Heaters[h].RelaisStatus = 0;
+    Heaters[h].RelaisLocked = 0;
+    for (int r = 0; r < 3; r++) {
+      Heaters[h].SwitchingCycles[r] = 20000UL * (h + r);
+      LockedUntil[h][r] = 0;
+    }
+  }
+}
+
+void runProfile(const char *name, int peak, int cloudiness) {
+  uint32_t totalMicros = 0;
+  uint32_t maxMicros = 0;
+  uint32_t toggles = 0;
+  int32_t exportWh = 0;
+
+  Seed = 1;
+  resetHeaters();
+  for (int minute = 0; minute < MINUTES_PER_DAY; minute++) {
+    int32_t surplus = surplusProfile(minute, peak, cloudiness);
+
+    for (int h = 0; h < HEATER_COUNT; h++) {
+      Heaters[h].RelaisLocked = 0;
+      for (int r = 0; r < 3; r++)
+        if (LockedUntil[h][r] > (uint32_t)minute)
+          Heaters[h].RelaisLocked |= (1 << r);
+    }
+
+    uint32_t start = micros();
+    int32_t assigned = Allocator.allocate(surplus, Heaters, HEATER_COUNT, Result);
+    uint32_t duration = micros() - start;
+    totalMicros += duration;
+    if (duration > maxMicros)
+      maxMicros = duration;
+    if (surplus > assigned)
+      exportWh += (surplus - assigned) / 60;
+
+    // apply the result: count switching operations, lock relais for 2 minutes (MinOnTime / MinOffTime), heat up the boilers
+    for (int h = 0; h < HEATER_COUNT; h++) {
+      uint8_t toggled = (Heaters[h].RelaisStatus ^ Result[h].RelaisStatus) & 0x07;
+      for (int r = 0; r < 3; r++) {
+        if (toggled & (1 << r)) {
+          toggles++;
+          Heaters[h].SwitchingCycles[r]++;
+          LockedUntil[h][r] = minute + 2;
+        }
+      }
+      Heaters[h].RelaisStatus = Result[h].RelaisStatus;
+      if (minute % 30 == 0)
+        Heaters[h].TemperatureBoiler += Result[h].RelaisStatus;
+    }
+  }
+
+  Serial.print(name);
+  Serial.print(": avg ");
+  Serial.print(totalMicros / MINUTES_PER_DAY);
+  Serial.print("us, max ");
+  Serial.print(maxMicros);
+  Serial.print("us, export ");
+  Serial.print(exportWh);
+  Serial.print("Wh, relais switching operations ");
+  Serial.println(toggles);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("\nAllocator benchmark");
+
+  runProfile("clear sky 8kW", 8000, 0);
+  runProfile("scattered clouds 8kW", 8000, 30);
+  runProfile("broken clouds 12kW", 12000, 70);
+  runProfile("winter 3kW", 3000, 50);
+}
+
+void loop() {
+}
@@ -0,0 +1,205 @@
+/****************************************************************************************************************************
+  DecoderBenchmark.ino - Check and benchmark of the register decoder against the former union based conversion
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// No RS485 hardware required, the register values are generated in the sketch.
+// The sketch compares EgoSmartHeaterDecoder with the union based conversion used by earlier versions of the library
+// for random register values, checks the decoding of known values (negative int32, float, BCD, odd register counts)
+// and prints the number of mismatches, failed checks and the time needed by both implementations.
+
+#include <EgoSmartHeaterDecoder.h>
+
+#define ITERATIONS 10000
+
+// the conversions are constexpr and checked at compile time
+static_assert(EgoSmartHeaterDecoder::toUint32(0x1234, 0x5678) == 0x12345678UL, "toUint32");
+static_assert(EgoSmartHeaterDecoder::toInt32(0xFFFF, 0xFFFE) == -2, "toInt32");
+static_assert(EgoSmartHeaterDecoder::getBcdYear(0x20140515UL) == 2014, "getBcdYear");
+static_assert(EgoSmartHeaterDecoder::getBcdMonth(0x20140515UL) == 5, "getBcdMonth");
+static_assert(EgoSmartHeaterDecoder::getBcdDay(0x20140515UL) == 15, "getBcdDay");
+
+uint32_t Seed = 1;
+volatile uint32_t Sink;
+
+// simple linear congruential generator, keeps the values reproducible on every platform
+uint16_t random16() {
+  Seed = Seed * 1103515245UL + 12345UL;
+  return Seed >> 16;
+}
+
+// former implementation of EgoSmartHeaterRS485::getModbusUint32
+uint32_t unionUint32(uint16_t data[2]) {
+  union u_data {
+    byte b[4];
+    uint16_t data[2];
+  } source;
+  union u_tag {
+    byte b[4];
+    uint32_t val;
+  } dest;
+
+  source.data[0] = data[0];
+  source.data[1] = data[1];
+  dest.b[2] = source.b[0];
+  dest.b[3] = source.b[1];
+  dest.b[0] = source.b[2];
+  dest.b[1] = source.b[3];
+  return dest.val;
+}
+
+// former implementation of EgoSmartHeaterRS485::getModbusFloat
+float unionFloat(uint16_t data[2]) {
+  union u_data {
+    byte b[4];
+    uint16_t data[2];
+  } source;
+  union u_tag {
+    byte b[4];
+    float val;
+  } dest;
+
+  source.data[0] = data[0];
+  source.data[1] = data[1];
+  dest.b[2] = source.b[0];
+  dest.b[3] = source.b[1];
+  dest.b[0] = source.b[2];
+  dest.b[1] = source.b[3];
+  return dest.val;
+}
+
+struct Block_t {
+  uint32_t Counter;
+  int16_t Temperature;
+  float Value;
+  char Text[33];
+};
+
+static const DecodeField_t BlockFields[] = {
+  {0, EGO_SH_DECODE_UINT32, offsetof(Block_t, Counter)},
+  {2, EGO_SH_DECODE_INT16, offsetof(Block_t, Temperature)},
+  {3, EGO_SH_DECODE_FLOAT, offsetof(Block_t, Value)},
+  {5, EGO_SH_DECODE_STRING32, offsetof(Block_t, Text)}};
+
+struct Signed_t {
+  int32_t Power;
+  float Value;
+};
+
+static const DecodeField_t SignedFields[] = {
+  {0, EGO_SH_DECODE_INT32, offsetof(Signed_t, Power)},
+  {2, EGO_SH_DECODE_FLOAT, offsetof(Signed_t, Value)}};
+
+uint16_t Failures = 0;
+
+void check(const char *name, bool ok) {
+  if (!ok) {
+    Failures++;
+    Serial.print("FAIL ");
+    Serial.println(name);
+  }
+}
+
+// decoding of known register values at run time
+void checkDecoder() {
+  uint16_t data[5] = {0xFFFF, 0xFF38, 0xC2F6, 0xE979, 'A' | ('B' << 8)};
+  Signed_t value;
+  char text[7];
+
+  check("negative int32", EgoSmartHeaterDecoder::toInt32(data[0], data[1]) == -200);
+  check("int32 sign bit", EgoSmartHeaterDecoder::toInt32(0x8000, 0x0000) == INT32_MIN);
+  check("float", EgoSmartHeaterDecoder::toFloat(0x3F80, 0x0000) == 1.0f && EgoSmartHeaterDecoder::toFloat(0xC000, 0x0000) == -2.0f);
+  check("negative float", EgoSmartHeaterDecoder::toFloat(data[2], data[3]) < -123.455f && EgoSmartHeaterDecoder::toFloat(data[2], data[3]) > -123.457f);
+  check("BCD", EgoSmartHeaterDecoder::fromBcd(0x1234) == 1234 && EgoSmartHeaterDecoder::fromBcd(0x99999999UL) == 99999999UL);
+  check("BCD date", EgoSmartHeaterDecoder::getBcdYear(0x20231231UL) == 2023 && EgoSmartHeaterDecoder::getBcdMonth(0x20231231UL) == 12 &&
+                      EgoSmartHeaterDecoder::getBcdDay(0x20231231UL) == 31);
+  check("block with negative int32", EgoSmartHeaterDecoder::decodeBlock(data, 4, SignedFields, 2, &value) && value.Power == -200 &&
+                                       value.Value < -123.455f && value.Value > -123.457f);
+  // odd number of registers: the last 32 bit value must not reach beyond the block
+  check("odd count", EgoSmartHeaterDecoder::decodeBlock(data, 5, SignedFields, 2, &value));
+  check("field beyond odd count", !EgoSmartHeaterDecoder::decodeBlock(data, 3, SignedFields, 2, &value));
+  EgoSmartHeaterDecoder::toChars(data + 4, 1, text);
+  check("string of 1 register", strcmp(text, "AB") == 0);
+  data[1] = 'C' | ('D' << 8);
+  data[2] = 'E';
+  EgoSmartHeaterDecoder::toChars(data + 0, 3, text);
+  check("string of 3 registers", text[2] == 'C' && text[3] == 'D' && text[4] == 'E' && text[5] == 0 && text[6] == 0);
+
+  Serial.print("Decoder checks failed: ");
+  Serial.println(Failures);
+}
+
+void setup() {
+  uint16_t data[21];
+  uint32_t mismatches = 0;
+  uint32_t start;
+
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("\nDecoder benchmark");
+
+  // compare both implementations
+  for (int i = 0; i < ITERATIONS; i++) {
+    data[0] = random16();
+    data[1] = random16();
+    float a = unionFloat(data);
+    float b = EgoSmartHeaterDecoder::toFloat(data[0], data[1]);
+    if (unionUint32(data) != EgoSmartHeaterDecoder::toUint32(data[0], data[1]))
+      mismatches++;
+    if ((int32_t)unionUint32(data) != EgoSmartHeaterDecoder::toInt32(data[0], data[1]))
+      mismatches++;
+    if (memcmp(&a, &b, sizeof(a)) != 0)
+      mismatches++;
+  }
+  Serial.print("Mismatches: ");
+  Serial.println(mismatches);
+
+  // block decoding, the string has its first character in the low byte of a register
+  Block_t block;
+  data[0] = 0x0001;
+  data[1] = 0x0002;
+  data[2] = (uint16_t)-12;
+  data[3] = 0x4049;
+  data[4] = 0x0FDB;
+  for (int j = 0; j < 16; j++)
+    data[5 + j] = 0;
+  data[5] = 'E' | ('.' << 8);
+  data[6] = 'G' | ('.' << 8);
+  data[7] = 'O' | ('.' << 8);
+  bool ok = EgoSmartHeaterDecoder::decodeBlock(data, 21, BlockFields, 4, &block) && block.Counter == 0x10002UL &&
+            block.Temperature == -12 && block.Value > 3.1415f && block.Value < 3.1417f && strcmp(block.Text, "E.G.O.") == 0;
+  Serial.println(ok ? "Block decoded" : "Block differs");
+
+  checkDecoder();
+
+  Seed = 1;
+  start = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    data[0] = random16();
+    data[1] = random16();
+    Sink = unionUint32(data);
+  }
+  Serial.print("union: ");
+  Serial.print(micros() - start);
+  Serial.print("us for ");
+  Serial.print(ITERATIONS);
+  Serial.println(" values");
+
+  Seed = 1;
+  start = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    data[0] = random16();
+    data[1] = random16();
+    Sink = EgoSmartHeaterDecoder::toUint32(data[0], data[1]);
+  }
+  Serial.print("decoder: ");
+  Serial.print(micros() - start);
+  Serial.print("us for ");
+  Serial.print(ITERATIONS);
+  Serial.println(" values");
+}
+
+void loop() {
+}
@@ -0,0 +1,51 @@
+/****************************************************************************************************************************
+  Discovery_ESP8266.ino - Scan the RS485 bus for EGO Smart Heaters with an ESP8266
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// EGO Smart Heater control
+#define DERE_PIN D1     // DE and RE Pin
+#define ENERGY_RX_PIN D2  // RO Pin
+#define ENERGY_TX_PIN D3  // DI Pin
+
+#include <SoftwareSerial.h>
+// use SW-serial, since ESP does not provide additional HW serial interfaces
+SoftwareSerial swSerial;
+#include <EgoSmartHeaterDiscovery.h>
+//Initialize the bus scan with the DE-RE pin number
+EgoSmartHeaterDiscovery Discovery(DERE_PIN);
+
+void setup() {
+  Serial.begin(115200);
+
+  // communicate with Modbus slaves via SW serial
+  swSerial.begin(EGO_SH_RS485_SERIAL_BAUD, SWSERIAL_8E1, ENERGY_RX_PIN, ENERGY_TX_PIN);
+  delay(5000);
+  Serial.println("\nScanning modbus addresses 1 - 247");
+
+  // the scan is performed step by step, one address per loop() call
+  Discovery.begin(swSerial);
+}
+
+void loop() {
+  if (Discovery.step())
+    return;
+
+  Serial.print("Devices found: ");
+  Serial.println(Discovery.getDeviceCount());
+  for (int i = 0; i < Discovery.getDeviceCount(); i++) {
+    const DiscoveredDevice_t &device = Discovery.getDevice(i);
+    Serial.print("Slave ID ");
+    Serial.print(device.SlaveId);
+    Serial.print(": ");
+    Serial.print(device.ProductName);
+    Serial.print(", SerialNumber ");
+    Serial.println(device.SerialNumber);
+  }
+
+  // scan again in a minute
+  delay(60000);
+  Discovery.begin(swSerial);
+}
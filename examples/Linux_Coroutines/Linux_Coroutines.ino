@@ -0,0 +1,154 @@
+/****************************************************************************************************************************
+  Linux_Coroutines.ino - Sequences of several heaters on several buses as C++20 coroutines in a single thread
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// Runs on Linux only, e.g. compiled with EpoxyDuino (https://github.com/bxparks/EpoxyDuino) with -std=gnu++20,
+// link with -pthread. Every bus is a pseudo terminal pair with a simulated heater, served by its own thread like an
+// independent device. All heater sequences run as coroutines in one EgoSmartHeaterEventLoop: the operations of the
+// sequences on the same bus are sent one after another, while the buses work in parallel.
+
+#if !defined(__linux__)
+#error "This example requires Linux"
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
+#include <EgoSmartHeaterCoroutine.h>
+#include <EgoSmartHeaterLinuxSerial.h>
+#include <EgoSmartHeaterSimulator.h>
+
+#if !defined(EGO_SH_COROUTINES)
+#error "This example requires C++20 coroutines, compile with -std=gnu++20"
+#endif
+
+#define BUSES 3
+#define RESPONSE_DELAY 10   // emulated bus time per transaction in milliseconds
+#define BOOST_TIMEOUT 2000  // the boost sequences are cancelled after this time in milliseconds
+#define PROBE_TIMEOUT 200   // response timeout of the first bus in milliseconds
+
+EgoSmartHeaterLinuxSerial BusSerial[BUSES];
+EgoSmartHeaterLinuxSerial SimulatorSerial[BUSES];
+EgoSmartHeaterSimulator Simulator[BUSES];
+EgoSmartHeaterAsyncClient Client[BUSES];
+EgoSmartHeaterEventLoop Loop;
+EgoSmartHeaterAsync Heater[BUSES] = {{Loop, 0}, {Loop, 1}, {Loop, 2}};
+EgoSmartHeaterAsync Missing(Loop, 0, 99);   // no device with this address on the first bus
+std::atomic<bool> Running(true);
+unsigned long Start;
+
+bool openBus(int b) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return false;
+  if (!BusSerial[b].begin(ptsname(master), EGO_SH_RS485_SERIAL_BAUD) || !SimulatorSerial[b].begin(master))
+    return false;
+  Simulator[b].setResponseDelay(RESPONSE_DELAY);
+  Simulator[b].begin(SimulatorSerial[b]);
+  Client[b].begin(BusSerial[b]);
+  return Loop.addBus(Client[b]) == b;
+}
+
+void report(EgoSmartHeaterAsync &heater, const char *text, int value) {
+  Serial.print(millis() - Start);
+  Serial.print("ms bus ");
+  Serial.print(heater.getBus());
+  Serial.print(" heater ");
+  Serial.print(heater.getSlaveId());
+  Serial.print(": ");
+  Serial.print(text);
+  Serial.print(" ");
+  Serial.println(value);
+}
+
+// write a temperature configuration, give the device some time and verify it
+EgoSmartHeaterTask configure(EgoSmartHeaterAsync &heater, uint16_t nominal) {
+  AsyncResult_t<int16_t> user = co_await heater.getUserTemperatureNominal();
+  if (user.ErrCode != ModbusMaster::ku8MBSuccess) {
+    report(heater, "getUserTemperatureNominal failed", user.ErrCode);
+    co_return;
+  }
+
+  TemperatureConfig_t config = {0, 80, nominal};
+  report(heater, "setTemperatureConfig", co_await heater.setTemperatureConfig(config, user.Value));
+  co_await Loop.sleep(500);
+  AsyncResult_t<TemperatureConfig_t> actual = co_await heater.getTemperatureConfig();
+  report(heater, "TemperatureNominalValue", actual.Value.TemperatureNominalValue);
+}
+
+// request a power and watch the relais, until the task is cancelled by its timeout
+EgoSmartHeaterTask boost(EgoSmartHeaterAsync &heater, int16_t power) {
+  uint8_t result = co_await heater.setPowerNominalValue(power);
+
+  while (result == ModbusMaster::ku8MBSuccess) {
+    result = co_await Loop.sleep(250);
+    if (result != ModbusMaster::ku8MBSuccess)
+      break;
+    AsyncResult_t<uint16_t> status = co_await heater.getRelaisStatus();
+    result = status.ErrCode;
+    if (result == ModbusMaster::ku8MBSuccess)
+      report(heater, "RelaisStatus", status.Value);
+  }
+  report(heater, "boost ended, result", result);
+}
+
+// the request to a missing device ends with the response timeout of the bus
+EgoSmartHeaterTask probe(EgoSmartHeaterAsync &heater) {
+  AsyncResult_t<int16_t> temperature = co_await heater.getActualTemperatureBoiler();
+  report(heater, "probe result", temperature.ErrCode);
+}
+
+// a long delay, cancelled by the next task
+EgoSmartHeaterTask wait(EgoSmartHeaterAsync &heater) {
+  report(heater, "wait result", co_await Loop.sleep(60000));
+}
+
+EgoSmartHeaterTask cancelLater(EgoSmartHeaterTask &task, uint32_t ms) {
+  co_await Loop.sleep(ms);
+  task.cancel();
+}
+
+void setup() {
+  std::thread simulators[BUSES];
+
+  for (int b = 0; b < BUSES; b++) {
+    if (!openBus(b)) {
+      Serial.println("Unable to create pseudo terminal");
+      exit(1);
+    }
+    simulators[b] = std::thread([b]() { while (Running) Simulator[b].poll(); });
+  }
+  Client[0].setTimeout(PROBE_TIMEOUT);
+
+  EgoSmartHeaterTask configureTasks[BUSES] = {configure(Heater[0], 50), configure(Heater[1], 55), configure(Heater[2], 60)};
+  EgoSmartHeaterTask boostTasks[BUSES] = {boost(Heater[0], 500), boost(Heater[1], 1000), boost(Heater[2], 1500)};
+  EgoSmartHeaterTask probeTask = probe(Missing);
+  EgoSmartHeaterTask waitTask = wait(Heater[1]);
+  EgoSmartHeaterTask cancelTask = cancelLater(waitTask, 300);
+
+  Start = millis();
+  for (int b = 0; b < BUSES; b++) {
+    Loop.spawn(configureTasks[b]);
+    Loop.spawn(boostTasks[b], BOOST_TIMEOUT);
+  }
+  Loop.spawn(probeTask);
+  Loop.spawn(waitTask);
+  Loop.spawn(cancelTask);
+  Loop.run();
+
+  Serial.print("All tasks done after ");
+  Serial.print(millis() - Start);
+  Serial.println("ms");
+
+  Running = false;
+  for (int b = 0; b < BUSES; b++)
+    simulators[b].join();
+  exit(0);
+}
+
+void loop() {
+}
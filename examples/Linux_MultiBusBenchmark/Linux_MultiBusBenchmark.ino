@@ -0,0 +1,139 @@
+/****************************************************************************************************************************
+  Linux_MultiBusBenchmark.ino - Throughput of EgoSmartHeaterMultiBus with an increasing number of simulated buses
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// Runs on Linux only, e.g. compiled with EpoxyDuino (https://github.com/bxparks/EpoxyDuino), link with -pthread.
+// Every bus is a pseudo terminal pair with a simulated heater. The simulator delays its responses to emulate
+// the bus time of a real RS485 segment at 19200 baud. The rate of polls is bound by that delay, so it only shows
+// that the buses don't block each other. The CPU time per poll shows the cost of the engine itself, it includes
+// the simulators. The buses are polled back to back (poll interval 0).
+// Finally the CPU time of an idle bus and of a bus polled at the default interval is measured.
+
+#if !defined(__linux__)
+#error "This example requires Linux"
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <thread>
+#include <atomic>
+#include <EgoSmartHeaterMultiBus.h>
+#include <EgoSmartHeaterLinuxSerial.h>
+#include <EgoSmartHeaterSimulator.h>
+
+#define DURATION 3000       // measurement time per configuration in milliseconds
+#define RESPONSE_DELAY 10   // emulated bus time per transaction in milliseconds
+
+EgoSmartHeaterLinuxSerial BusSerial[EGO_SH_MULTIBUS_MAX_BUSES];
+EgoSmartHeaterLinuxSerial SimulatorSerial[EGO_SH_MULTIBUS_MAX_BUSES];
+EgoSmartHeaterSimulator Simulator[EGO_SH_MULTIBUS_MAX_BUSES];
+std::atomic<bool> Running(true);
+
+// CPU time of the process (all threads) in microseconds
+uint64_t cpuTime() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// CPU time of an engine running for the measurement time, in milliseconds
+float idleCpu(EgoSmartHeaterMultiBus &engine) {
+  uint64_t cpu = cpuTime();
+  engine.start();
+  delay(DURATION);
+  engine.stop();
+  return (cpuTime() - cpu) / 1000.0;
+}
+
+bool openBus(int b) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return false;
+  if (!BusSerial[b].begin(ptsname(master), EGO_SH_RS485_SERIAL_BAUD) || !SimulatorSerial[b].begin(master))
+    return false;
+  Simulator[b].setResponseDelay(RESPONSE_DELAY);
+  Simulator[b].begin(SimulatorSerial[b]);
+  return true;
+}
+
+void setup() {
+  float single = 0;
+
+  for (int b = 0; b < EGO_SH_MULTIBUS_MAX_BUSES; b++) {
+    if (!openBus(b)) {
+      Serial.println("Unable to create pseudo terminal");
+      exit(1);
+    }
+  }
+
+  for (int buses = 1; buses <= EGO_SH_MULTIBUS_MAX_BUSES; buses *= 2) {
+    EgoSmartHeaterMultiBus engine;
+    std::thread simulators[EGO_SH_MULTIBUS_MAX_BUSES];
+
+    // one simulator thread per bus, like independent devices
+    Running = true;
+    for (int b = 0; b < buses; b++) {
+      int bus = engine.addBus(BusSerial[b]);
+      engine.addHeater(bus);
+      engine.setPollInterval(bus, 0);
+      simulators[b] = std::thread([b]() { while (Running) Simulator[b].poll(); });
+    }
+
+    uint64_t cpu = cpuTime();
+    engine.start();
+    unsigned long start = millis();
+    delay(DURATION);
+    uint32_t polls = engine.getPollCount();
+    unsigned long duration = millis() - start;
+    engine.stop();
+    cpu = cpuTime() - cpu;
+    Running = false;
+    for (int b = 0; b < buses; b++)
+      simulators[b].join();
+
+    float rate = polls * 1000.0 / duration;
+    if (buses == 1)
+      single = rate;
+    Serial.print(buses);
+    Serial.print(" bus(es): ");
+    Serial.print(rate);
+    Serial.print(" polls/s, scaling ");
+    Serial.print(rate / single);
+    Serial.print(", CPU ");
+    Serial.print(polls > 0 ? cpu / (float)polls : 0);
+    Serial.println(" us/poll");
+  }
+
+  // a bus without heaters must not spin
+  EgoSmartHeaterMultiBus idle;
+  idle.addBus(BusSerial[0]);
+  Serial.print("idle bus: ");
+  Serial.print(idleCpu(idle));
+  Serial.print(" ms CPU in ");
+  Serial.print(DURATION);
+  Serial.println(" ms");
+
+  // a heater polled at the default interval
+  EgoSmartHeaterMultiBus paced;
+  paced.addHeater(paced.addBus(BusSerial[0]));
+  Running = true;
+  std::thread simulator([]() { while (Running) Simulator[0].poll(); });
+  float cpu = idleCpu(paced);
+  Running = false;
+  simulator.join();
+  Serial.print("default interval: ");
+  Serial.print(paced.getPollCount());
+  Serial.print(" polls, ");
+  Serial.print(cpu);
+  Serial.print(" ms CPU in ");
+  Serial.print(DURATION);
+  Serial.println(" ms");
+  exit(0);
+}
+
+void loop() {
+}
@@ -0,0 +1,135 @@
+/****************************************************************************************************************************
+  Linux_PtyLoopback.ino - End to end test of the Linux serial backend against the simulated heater
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// Runs on Linux only, e.g. compiled with EpoxyDuino (https://github.com/bxparks/EpoxyDuino), link with -pthread.
+// A pseudo terminal pair replaces the RS485 bus: the simulated heater serves the master side,
+// the library talks to the slave side through EgoSmartHeaterLinuxSerial exactly like to /dev/ttyUSB0.
+
+#if !defined(__linux__)
+#error "This example requires Linux"
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
+#include <EgoSmartHeaterRS485.h>
+#include <EgoSmartHeaterLinuxSerial.h>
+#include <EgoSmartHeaterSimulator.h>
+#include <EgoSmartHeaterEnergyMeter.h>
+
+EgoSmartHeaterLinuxSerial BusSerial;
+EgoSmartHeaterLinuxSerial SimulatorSerial;
+EgoSmartHeaterSimulator Simulator;
+EgoSmartHeaterRS485 Heater;
+std::atomic<bool> Running(true);
+
+void runSimulator() {
+  while (Running) {
+    Simulator.poll();
+  }
+}
+
+void check(const char *name, bool ok) {
+  Serial.print(ok ? "OK   " : "FAIL ");
+  Serial.println(name);
+  if (!ok) {
+    Running = false;
+    exit(1);
+  }
+}
+
+// pass the counters to the meter if both reads succeeded
+bool sampleEnergy(EgoSmartHeaterEnergyMeter &meter) {
+  uint32_t restartCounter = Heater.getRestartCounter();
+  if (Heater.getErrCode() != 0)
+    return false;
+  RelaisOperatingTime_t time = Heater.getRelaisOperatingTime();
+  if (Heater.getErrCode() != 0)
+    return false;
+  return meter.update(millis(), restartCounter, time);
+}
+
+void setup() {
+  // create the pseudo terminal pair
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    Serial.println("Unable to create pseudo terminal");
+    exit(1);
+  }
+  const char *device = ptsname(master);
+
+  // the slave side is configured like a real RS485 adapter (8E1, 19200 baud)
+  check("open serial device", BusSerial.begin(device, EGO_SH_RS485_SERIAL_BAUD));
+  check("attach simulator", SimulatorSerial.begin(master));
+  Simulator.begin(SimulatorSerial);
+  std::thread simulator(runSimulator);
+
+  Heater.begin(BusSerial);
+  check("ManufacturerId", Heater.getManufacturerId() == 0x14EF);
+  check("VendorName", Heater.getVendorName() == String("E.G.O."));
+  check("SerialNumber", Heater.getSerialNumber() == String("30380912332211"));
+  check("RelaisCount", Heater.getRelaisCount() == 3);
+  check("ProductionDate", Heater.getProductionDate() == 0x20140515);
+
+  check("setPowerNominalValue", Heater.setPowerNominalValue(1500) == 0);
+  check("RelaisStatus", Heater.getRelaisStatus() == 3);
+  check("PowerNominalValue", Heater.getPowerNominalValue() == 1500);
+
+  check("setHomeTotalPower", Heater.setPowerNominalValue(-1) == 0 && Heater.setHomeTotalPower(-2600) == 0);
+  check("HomeTotalPower", Heater.getHomeTotalPower() == -2600);
+
+  check("invalid TemperatureNominalValue refused", Heater.setTemperatureNominalValue(90) == 3);
+
+  TemperatureConfig_t config = {0, 75, 55};
+  check("setTemperatureConfig", Heater.setTemperatureConfig(config) == 0);
+  TemperatureConfig_t readBack = Heater.getTemperatureConfig();
+  check("getTemperatureConfig", readBack.TemperatureMaxValue == 75 && readBack.TemperatureNominalValue == 55);
+  config.TemperatureMinValue = 55;
+  check("invalid TemperatureConfig not sent", Heater.setTemperatureConfig(config, 60) == EGO_SH_RS485_INVALID_VALUE);
+  Heater.getRelaisConfiguration(0);
+  check("relais configuration", Heater.getErrCode() == 0);
+  check("setRelaisMinOnTime", Heater.setRelaisMinOnTime(2, 30) == 0);
+  uint32_t requests = Simulator.getRequestCount();
+  RelaisConfigurationSet_t relais = Heater.getRelaisConfigurations();
+  check("all relais configurations", Heater.getErrCode() == 0 && relais.Valid[0] && relais.Valid[1] && relais.Valid[2] &&
+                                     relais.Relais[2].MinOnTime == 30 && Simulator.getRequestCount() - requests == 3);
+  check("relais out of range refused", Heater.setRelaisMinOffTime(3, 10) == EGO_SH_RS485_INVALID_VALUE);
+
+  OperatingData_t operating = Heater.getOperatingData();
+  check("operating data", Heater.getErrCode() == 0 && operating.TemperaturePCB == 35 && operating.RelaisStatus == Heater.getRelaisStatus());
+  Heater.getErrorLog();
+  check("error log", Heater.getErrCode() == 0);
+
+  EgoSmartHeaterEnergyMeter meter;
+  meter.setRelaisPower(relais);
+  check("setPowerNominalValue", Heater.setPowerNominalValue(1500) == 0);
+  check("first energy sample", sampleEnergy(meter) == false && Heater.getErrCode() == 0);
+  delay(3500);
+  check("energy meter", sampleEnergy(meter) && meter.getEnergyWs() >= 2 * 500 && meter.getEnergyWs() <= 4 * 3500);
+  RelaisOperatingTime_t failed = {0, 0, 0};
+  uint64_t energy = meter.getEnergyWs();
+  check("failed read rejected", !meter.update(millis(), 0, failed) && !meter.update(millis(), Heater.getRestartCounter(), failed) &&
+                                meter.getEnergyWs() == energy && meter.getRejectedCount() == 2);
+  // a relais which never ran reports 0 also in a successful read, the failed read must not become the base
+  EgoSmartHeaterEnergyMeter idle;
+  RelaisOperatingTime_t before = {1000, 500, 0};
+  RelaisOperatingTime_t after = {1060, 560, 0};
+  check("failed read rejected with an idle relais", !idle.update(0, 5, before) && !idle.update(60000, 5, failed) &&
+                                                   idle.update(120000, 5, after) && idle.getEnergyWs() == 60 * 500 + 60 * 1000 &&
+                                                   idle.getRejectedCount() == 1);
+  delay(1500);
+  check("energy meter after failed read", sampleEnergy(meter) && meter.getEnergyWs() > energy);
+
+  Running = false;
+  simulator.join();
+  Serial.println("Done");
+  exit(0);
+}
+
+void loop() {
+}
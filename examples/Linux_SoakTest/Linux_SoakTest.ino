@@ -0,0 +1,358 @@
+/****************************************************************************************************************************
+  Linux_SoakTest.ino - Long running control and telemetry workload against a simulated heater with injected faults
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// Runs on Linux only, e.g. compiled with EpoxyDuino (https://github.com/bxparks/EpoxyDuino), link with -pthread.
+// The simulated heater runs on a pseudo terminal pair with an accelerated clock and injects CRC errors, partial
+// frames, exceptions 2 and 3 and restarts. The sketch drives the workload of a PV surplus controller: the activation is
+// renewed every 30 seconds, the relais and the boiler are polled, the operating data is read for an energy meter and
+// the configuration and error log are published as telemetry records. Every simulated hour it reports throughput,
+// latency percentiles and the heap in use, at the end the keepalive deadlines missed by the simulated device.
+// The run fails (exit code 1) if a keepalive was missed or the heap grew after the first hour.
+//
+// The bus timing and the response timeout of ModbusMaster (2 seconds) are not accelerated: a lost response costs
+// TIME_SCALE * 2 seconds of simulated time. With a larger TIME_SCALE the missed keepalives are caused by the test.
+// Set the duration and the time scale by compiler flags, e.g. -DDURATION_HOURS=336 for two weeks.
+
+#if !defined(__linux__)
+#error "This example requires Linux"
+#endif
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <thread>
+#include <atomic>
+#include <EgoSmartHeaterRS485.h>
+#include <EgoSmartHeaterEnergyMeter.h>
+#include <EgoSmartHeaterTelemetry.h>
+#include <EgoSmartHeaterLinuxSerial.h>
+#include <EgoSmartHeaterSimulator.h>
+
+#if !EGO_SH_FEATURE_TELEMETRY || !EGO_SH_FEATURE_ERROR_LOG
+#error "This example requires the telemetry build profile"
+#endif
+
+#ifndef DURATION_HOURS
+#define DURATION_HOURS 24         // simulated run time in hours
+#endif
+#ifndef TIME_SCALE
+#define TIME_SCALE 10             // simulated milliseconds per real millisecond
+#endif
+#define START_HOUR 6              // simulated time of day at the start
+#define RESPONSE_DELAY 5          // emulated bus time per transaction in milliseconds
+
+// workload, in simulated milliseconds
+#define KEEPALIVE_INTERVAL 30000  // renewal of the activation
+#define CONTROL_INTERVAL 5000     // relais status, boiler temperature and PowerNominalValue
+#define METER_INTERVAL 60000      // operating data for the energy meter
+#define CONFIG_INTERVAL 600000    // temperature configuration, relais configuration and error log
+#define REPORT_INTERVAL 3600000
+
+// injected faults per 10000 requests
+#define CRC_ERRORS 50
+#define PARTIAL_FRAMES 10
+#define EXCEPTIONS2 20
+#define EXCEPTIONS3 20
+#define REBOOTS 2
+
+#define LATENCY_BUCKETS 32768     // in steps of 100 microseconds
+#define MAX_HEAP_GROWTH 1024      // tolerated growth of the heap in use after the first hour in bytes
+
+EgoSmartHeaterLinuxSerial BusSerial;
+EgoSmartHeaterLinuxSerial SimulatorSerial;
+EgoSmartHeaterSimulator Simulator;
+EgoSmartHeaterRS485 Heater;
+EgoSmartHeaterEnergyMeter Meter;
+std::atomic<bool> Running(true);
+
+uint32_t Latency[LATENCY_BUCKETS];
+uint32_t Errors[256];
+uint32_t Operations = 0;
+uint32_t Reboots = 0;
+uint32_t Records = 0;
+uint32_t UnchangedDeltas = 0;
+size_t HeapBase = 0;
+size_t HeapMax = 0;
+
+bool openBus() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return false;
+  if (!BusSerial.begin(ptsname(master), EGO_SH_RS485_SERIAL_BAUD) || !SimulatorSerial.begin(master))
+    return false;
+  Simulator.setResponseDelay(RESPONSE_DELAY);
+  Simulator.setTimeScale(TIME_SCALE);
+  Simulator.setFaultRate(EGO_SH_SIM_FAULT_CRC, CRC_ERRORS);
+  Simulator.setFaultRate(EGO_SH_SIM_FAULT_PARTIAL, PARTIAL_FRAMES);
+  Simulator.setFaultRate(EGO_SH_SIM_FAULT_EXCEPTION2, EXCEPTIONS2);
+  Simulator.setFaultRate(EGO_SH_SIM_FAULT_EXCEPTION3, EXCEPTIONS3);
+  Simulator.setFaultRate(EGO_SH_SIM_FAULT_REBOOT, REBOOTS);
+  Simulator.begin(SimulatorSerial);
+  Heater.begin(BusSerial);
+  return true;
+}
+
+size_t getHeapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  return mallinfo2().uordblks;
+#else
+  return (unsigned)mallinfo().uordblks;
+#endif
+}
+
+// record the latency and the result of the last library call, started at start (micros())
+uint8_t measure(unsigned long start) {
+  unsigned long bucket = (micros() - start) / 100;
+  uint8_t result = Heater.getErrCode(true);
+
+  Latency[(bucket < LATENCY_BUCKETS) ? bucket : LATENCY_BUCKETS - 1]++;
+  Errors[result]++;
+  Operations++;
+  // the high-water mark is tracked once the first hour set the base, peaks of the warm-up are no leak
+  size_t heap = getHeapInUse();
+  if (HeapBase > 0 && heap > HeapMax)
+    HeapMax = heap;
+  return result;
+}
+
+// latency in milliseconds below which the given share of the operations completed
+float getPercentile(float share) {
+  uint32_t count = 0;
+  for (int b = 0; b < LATENCY_BUCKETS; b++) {
+    count += Latency[b];
+    if (count >= share * Operations)
+      return (b + 1) / 10.0;
+  }
+  return LATENCY_BUCKETS / 10.0;
+}
+
+bool due(unsigned long now, unsigned long &last, unsigned long interval) {
+  if (now - last < interval)
+    return false;
+  last = now;
+  return true;
+}
+
+// PV surplus over the day, in steps of 500W
+int16_t getSurplus(unsigned long now) {
+  float hour = fmod(START_HOUR + now / 3600000.0, 24);
+  if (hour < 6 || hour > 18)
+    return 0;
+  return (int16_t)(3500 * sin(M_PI * (hour - 6) / 12) / 500) * 500;
+}
+
+void report(unsigned long now, unsigned long realStart) {
+  Serial.print("hour ");
+  Serial.print(now / 3600000);
+  Serial.print(": ");
+  Serial.print(Operations);
+  Serial.print(" operations, ");
+  Serial.print(Operations * 1000.0 / (millis() - realStart));
+  Serial.print("/s, latency p50 ");
+  Serial.print(getPercentile(0.5));
+  Serial.print("ms p99 ");
+  Serial.print(getPercentile(0.99));
+  Serial.print("ms, failed ");
+  Serial.print(Operations - Errors[ModbusMaster::ku8MBSuccess]);
+  Serial.print(", restarts ");
+  Serial.print(Reboots);
+  Serial.print(", heap ");
+  Serial.print((unsigned long)getHeapInUse());
+  Serial.print(" B, boiler ");
+  Serial.print(Simulator.getTemperatureBoiler());
+  Serial.print(" C, energy ");
+  Serial.print(Meter.getEnergyKWh());
+  Serial.println(" kWh");
+}
+
+void setup() {
+  if (!openBus()) {
+    Serial.println("Unable to create pseudo terminal");
+    exit(1);
+  }
+  std::thread simulator([]() { while (Running) Simulator.poll(); });
+
+  unsigned long start = Simulator.getTime();
+  unsigned long realStart = millis();
+  unsigned long lastKeepalive = start - KEEPALIVE_INTERVAL;
+  unsigned long lastControl = start;
+  unsigned long lastMeter = start - METER_INTERVAL;
+  unsigned long lastConfig = start - CONFIG_INTERVAL;
+  unsigned long lastReport = start;
+  unsigned long lastRenewal = start;
+  unsigned long maxRenewalGap = 0;
+  uint32_t restartCounter = 0;
+  int16_t power = 0;
+  bool renew = true;
+  OperatingData_t published;
+  bool havePublished = false;
+  uint8_t record[EGO_SH_TELEMETRY_MAX_RECORD];
+
+  while (Simulator.getTime() - start < DURATION_HOURS * 3600000UL) {
+    unsigned long now = Simulator.getTime();
+    unsigned long t;
+    bool busy = false;
+
+    // control: renew the activation, immediately again after a failure or if the heater lost it
+    if (renew || due(now, lastKeepalive, KEEPALIVE_INTERVAL)) {
+      int16_t requested = getSurplus(now - start);
+      lastKeepalive = now;
+      t = micros();
+      Heater.setPowerNominalValue(requested);
+      renew = (measure(t) != ModbusMaster::ku8MBSuccess);
+      if (!renew) {
+        unsigned long renewed = Simulator.getTime();
+        if (power != 0 && renewed - lastRenewal > maxRenewalGap)
+          maxRenewalGap = renewed - lastRenewal;
+        lastRenewal = renewed;
+        power = requested;
+      }
+      busy = true;
+    }
+    if (due(now, lastControl, CONTROL_INTERVAL)) {
+      t = micros();
+      int16_t nominal = Heater.getPowerNominalValue();
+      if (measure(t) == ModbusMaster::ku8MBSuccess && nominal != power)
+        renew = true;
+      t = micros();
+      Heater.getRelaisStatus();
+      measure(t);
+      t = micros();
+      Heater.getActualTemperatureBoiler();
+      measure(t);
+      busy = true;
+    }
+
+    // telemetry: energy meter, restarts of the heater
+    if (due(now, lastMeter, METER_INTERVAL)) {
+      t = micros();
+      OperatingData_t data = Heater.getOperatingData();
+      if (measure(t) == ModbusMaster::ku8MBSuccess) {
+        if (restartCounter != 0 && data.RestartCounter != restartCounter) {
+          Reboots++;
+          renew = true;
+        }
+        restartCounter = data.RestartCounter;
+        Meter.update(Simulator.getTime(), data.RestartCounter, data.OperatingTime);
+        // the buffer holds any full record, so a delta of size 0 has no changed field
+        if (EgoSmartHeaterTelemetry::encode(record, sizeof(record), 1, data, havePublished ? &published : NULL) > 0)
+          Records++;
+        else if (havePublished)
+          UnchangedDeltas++;
+        published = data;
+        havePublished = true;
+      }
+      busy = true;
+    }
+    if (due(now, lastConfig, CONFIG_INTERVAL)) {
+      t = micros();
+      TemperatureConfig_t config = Heater.getTemperatureConfig();
+      if (measure(t) == ModbusMaster::ku8MBSuccess) {
+        config.TemperatureNominalValue = (config.TemperatureNominalValue == 55) ? 60 : 55;
+        t = micros();
+        Heater.setTemperatureConfig(config);
+        measure(t);
+      }
+      t = micros();
+      RelaisConfigurationSet_t relais = Heater.getRelaisConfigurations();
+      if (measure(t) == ModbusMaster::ku8MBSuccess) {
+        Meter.setRelaisPower(relais);
+        if (EgoSmartHeaterTelemetry::encode(record, sizeof(record), 1, relais) > 0)
+          Records++;
+      }
+      t = micros();
+      ErrorLog_t log = Heater.getErrorLog();
+      if (measure(t) == ModbusMaster::ku8MBSuccess && EgoSmartHeaterTelemetry::encode(record, sizeof(record), 1, log) > 0)
+        Records++;
+      busy = true;
+    }
+
+    if (due(now, lastReport, REPORT_INTERVAL)) {
+      report(now - start, realStart);
+      // the first hour allocates the buffers of the C library, later growth is a leak
+      if (HeapBase == 0)
+        HeapBase = getHeapInUse();
+    }
+    if (!busy)
+      delay(1);
+  }
+
+  Running = false;
+  simulator.join();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  size_t heapGrowth = (HeapBase > 0 && HeapMax > HeapBase) ? HeapMax - HeapBase : 0;
+  uint32_t missed = Simulator.getKeepaliveMissCount();
+
+  Serial.println();
+  Serial.print("Simulated hours: ");
+  Serial.println(DURATION_HOURS);
+  Serial.print("Operations: ");
+  Serial.print(Operations);
+  Serial.print(" (");
+  Serial.print(Operations * 1000.0 / (millis() - realStart));
+  Serial.print("/s), requests received by the heater: ");
+  Serial.println(Simulator.getRequestCount());
+  Serial.print("Latency ms: p50 ");
+  Serial.print(getPercentile(0.5));
+  Serial.print(" p90 ");
+  Serial.print(getPercentile(0.9));
+  Serial.print(" p99 ");
+  Serial.print(getPercentile(0.99));
+  Serial.print(" p99.9 ");
+  Serial.println(getPercentile(0.999));
+  for (int e = 1; e < 256; e++) {
+    if (Errors[e] > 0) {
+      Serial.print("Result ");
+      Serial.print(e);
+      Serial.print(": ");
+      Serial.println(Errors[e]);
+    }
+  }
+  const char *faults[EGO_SH_SIM_FAULT_TYPES] = {"CRC errors", "partial frames", "exceptions 2", "exceptions 3", "restarts"};
+  Serial.print("Injected faults:");
+  for (int f = 0; f < EGO_SH_SIM_FAULT_TYPES; f++) {
+    Serial.print(" ");
+    Serial.print(faults[f]);
+    Serial.print(" ");
+    Serial.print(Simulator.getFaultCount(f));
+  }
+  Serial.println();
+  Serial.print("Restarts detected by RestartCounter: ");
+  Serial.println(Reboots);
+  Serial.print("Telemetry records: ");
+  Serial.print(Records);
+  Serial.print(", unchanged deltas ");
+  Serial.print(UnchangedDeltas);
+  Serial.print(", energy ");
+  Serial.print(Meter.getEnergyKWh());
+  Serial.print(" kWh, rejected samples ");
+  Serial.println(Meter.getRejectedCount());
+  Serial.print("Keepalive: longest renewal interval ");
+  Serial.print(maxRenewalGap / 1000);
+  Serial.print("s, missed deadlines ");
+  Serial.println(missed);
+  Serial.print("Memory: heap in use ");
+  Serial.print((unsigned long)getHeapInUse());
+  Serial.print(" B, high-water after the first hour ");
+  Serial.print((unsigned long)HeapMax);
+  Serial.print(" B, growth after the first hour ");
+  Serial.print((unsigned long)heapGrowth);
+  Serial.print(" B, peak RSS ");
+  Serial.print(usage.ru_maxrss);
+  Serial.println(" kB");
+
+  bool passed = (missed == 0 && heapGrowth <= MAX_HEAP_GROWTH);
+  Serial.println(passed ? "PASSED" : "FAILED");
+  exit(passed ? 0 : 1);
+}
+
+void loop() {
+}
@@ -0,0 +1,68 @@
+/****************************************************************************************************************************
+  PollSchedulerCheck.ino - Checks of the poll scheduler calculation
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// No RS485 hardware required, the temperatures are passed by the sketch.
+// The sketch feeds known samples into EgoSmartHeaterPollScheduler and checks the scheduled polls. It prints the
+// failed checks and their number.
+
+#include <EgoSmartHeaterPollScheduler.h>
+
+uint16_t Failures = 0;
+
+void check(const char *name, bool ok) {
+  if (!ok) {
+    Failures++;
+    Serial.print("FAIL ");
+    Serial.println(name);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("\nPoll scheduler check");
+
+  // a sample far off the model (hot water drawn) is polled again after the shortest interval
+  EgoSmartHeaterPollScheduler scheduler;
+  scheduler.setModel(5, 1);
+  scheduler.addThreshold(80);
+  scheduler.update(0, 40, 0);
+  scheduler.update(600000, 30, 0);
+  check("unexpected sample", scheduler.getNextPoll() == 600000 + EGO_SH_SCHED_MIN_INTERVAL);
+
+  // TemperatureNominalValue 0: the potentiometer position is watched
+  EgoSmartHeaterPollScheduler potentiometer;
+  TemperatureConfig_t thresholds = {0, 80, 0};
+  potentiometer.setModel(5, 1);
+  potentiometer.setThresholds(thresholds, 60);
+  potentiometer.update(0, 59, 1);
+  check("potentiometer threshold", potentiometer.getNextPoll() < EGO_SH_SCHED_MAX_INTERVAL);
+
+  // a boiler sitting at a threshold is polled after the shortest interval, heating and cooling
+  EgoSmartHeaterPollScheduler heating;
+  heating.setModel(5, 1);
+  heating.addThreshold(60);
+  heating.update(0, 60, 1);
+  check("at threshold heating", heating.getNextPoll() == EGO_SH_SCHED_MIN_INTERVAL);
+  EgoSmartHeaterPollScheduler cooling;
+  cooling.setModel(5, 1);
+  cooling.addThreshold(60);
+  cooling.update(0, 60, 0);
+  check("at threshold cooling", cooling.getNextPoll() == EGO_SH_SCHED_MIN_INTERVAL);
+  // one degree away and moving away from it, the threshold is behind the trend
+  EgoSmartHeaterPollScheduler away;
+  away.setModel(5, 1);
+  away.addThreshold(60);
+  away.update(0, 61, 1);
+  check("threshold behind the trend", away.getNextPoll() == EGO_SH_SCHED_MAX_INTERVAL);
+
+  Serial.print("Checks failed: ");
+  Serial.println(Failures);
+}
+
+void loop() {
+}
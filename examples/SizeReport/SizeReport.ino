@@ -0,0 +1,62 @@
+/****************************************************************************************************************************
+  SizeReport.ino - Uses every function of the selected build profile, to measure its flash and RAM cost
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// Built by extras/size_report.sh for every build profile and feature (see EgoSmartHeaterConfig.h).
+// The linker drops functions which are never called, so the sketch calls all functions the profile provides,
+// like a firmware using the profile completely would do. It is not meant to be run.
+
+#include <EgoSmartHeaterRS485.h>
+#include <EgoSmartHeaterTelemetry.h>
+
+EgoSmartHeaterRS485 Heater;
+volatile uint32_t Sink;
+
+void setup() {
+  Serial.begin(EGO_SH_RS485_SERIAL_BAUD);
+  Heater.begin(Serial);
+}
+
+void loop() {
+  // control, available in every profile
+  TemperatureConfig_t config = Heater.getTemperatureConfig();
+  Heater.setTemperatureConfig(config);
+  Heater.setPowerNominalValue(500);
+  Heater.setHomeTotalPower(-1000);
+  Sink = Heater.getPowerNominalValue() + Heater.getHomeTotalPower() + Heater.getActualTemperatureBoiler() +
+         Heater.getUserTemperatureNominal() + Heater.getRelaisStatus() + Heater.getTemperatureMinValue() +
+         Heater.getTemperatureMaxValue() + Heater.getTemperatureNominalValue() + Heater.getManufacturerId() +
+         Heater.getProductId() + Heater.getProductVersion() + Heater.getFirmwareVersion() + Heater.getErrCode(true);
+
+#if EGO_SH_FEATURE_TELEMETRY
+  OperatingData_t data = Heater.getOperatingData();
+  RelaisConfigurationSet_t relais = Heater.getRelaisConfigurations();
+  uint8_t record[EGO_SH_TELEMETRY_MAX_RECORD];
+  Sink = EgoSmartHeaterTelemetry::encode(record, sizeof(record), 1, data, NULL) +
+         EgoSmartHeaterTelemetry::encode(record, sizeof(record), 1, relais, NULL) +
+         Heater.getRelaisConfiguration(0).ActualPower + Heater.getRelaisCount() + Heater.getRestartCounter() +
+         Heater.getActualTemperaturePCB() + Heater.getTotalOperatingSeconds() + Heater.getErrorCounter() +
+         Heater.getActualTemperatureExternalSensor1() + Heater.getActualTemperatureExternalSensor2() +
+         Heater.getRelaisOperatingTime().OperatingSeconds1;
+#endif
+
+#if EGO_SH_FEATURE_ERROR_LOG
+  Sink = Heater.getErrorLog().Error[0].ErrorCode + Heater.getError(0).ErrorCode;
+#endif
+
+#if EGO_SH_FEATURE_IDENTITY
+  DeviceProfile_t profile;
+  Sink = Heater.readDeviceProfile(profile) + Heater.validateDeviceProfile(profile) + Heater.getProductionDate() +
+         Heater.getVendorName().length() + Heater.getProductName().length() + Heater.getSerialNumber().length();
+#endif
+
+#if EGO_SH_FEATURE_SETUP
+  Sink = Heater.setTemperatureMinValue(0) + Heater.setTemperatureMaxValue(80) + Heater.setTemperatureNominalValue(0) +
+         Heater.setRelaisMinOnTime(0, 30) + Heater.setRelaisMinOffTime(0, 30);
+#endif
+
+  delay(1000);
+}
@@ -0,0 +1,138 @@
+/****************************************************************************************************************************
+  TelemetryBenchmark.ino - Benchmark of the binary telemetry records against JSON built with String
+
+  Built by Thomas Hock https://github.com/th-hock
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+
+// No RS485 hardware required, the snapshots are generated in the sketch.
+// The sketch encodes the same sequence of operating snapshots as JSON (String concatenation, as usually done before
+// publishing by MQTT), as full binary records and as delta records, and prints the average size and the total encoding time.
+
+#include <EgoSmartHeaterTelemetry.h>
+
+#define ITERATIONS 1000
+
+OperatingData_t Snapshot;
+OperatingData_t Previous;
+uint8_t Buffer[EGO_SH_TELEMETRY_MAX_RECORD];
+
+void initSnapshot() {
+  memset(&Snapshot, 0, sizeof(Snapshot));
+  Snapshot.RestartCounter = 12;
+  Snapshot.TemperaturePCB = 35;
+  Snapshot.TotalOperatingSeconds = 31536000UL;
+  Snapshot.ErrorCounter = 2;
+  Snapshot.TemperatureBoiler = 45;
+  Snapshot.TemperatureExternalSensor1 = (int16_t)0x8001;
+  Snapshot.TemperatureExternalSensor2 = (int16_t)0x8001;
+  Snapshot.UserTemperatureNominal = 60;
+  Snapshot.RelaisStatus = 3;
+  Snapshot.OperatingTime.OperatingSeconds1 = 8000000UL;
+  Snapshot.OperatingTime.OperatingSeconds2 = 6000000UL;
+  Snapshot.OperatingTime.OperatingSeconds3 = 3000000UL;
+}
+
+// one poll interval of 10 seconds, the boiler warms up by 1K every 2 minutes
+void advanceSnapshot(int i) {
+  Snapshot.TotalOperatingSeconds += 10;
+  Snapshot.OperatingTime.OperatingSeconds1 += 10;
+  Snapshot.OperatingTime.OperatingSeconds2 += 10;
+  if (i % 12 == 0)
+    Snapshot.TemperatureBoiler++;
+}
+
+String toJson(const OperatingData_t &data) {
+  String json = "{\"RestartCounter\":";
+  json += data.RestartCounter;
+  json += ",\"TemperaturePCB\":";
+  json += data.TemperaturePCB;
+  json += ",\"TotalOperatingSeconds\":";
+  json += data.TotalOperatingSeconds;
+  json += ",\"ErrorCounter\":";
+  json += data.ErrorCounter;
+  json += ",\"TemperatureBoiler\":";
+  json += data.TemperatureBoiler;
+  json += ",\"TemperatureExternalSensor1\":";
+  json += data.TemperatureExternalSensor1;
+  json += ",\"TemperatureExternalSensor2\":";
+  json += data.TemperatureExternalSensor2;
+  json += ",\"UserTemperatureNominal\":";
+  json += data.UserTemperatureNominal;
+  json += ",\"RelaisStatus\":";
+  json += data.RelaisStatus;
+  json += ",\"OperatingSeconds1\":";
+  json += data.OperatingTime.OperatingSeconds1;
+  json += ",\"OperatingSeconds2\":";
+  json += data.OperatingTime.OperatingSeconds2;
+  json += ",\"OperatingSeconds3\":";
+  json += data.OperatingTime.OperatingSeconds3;
+  json += "}";
+  return json;
+}
+
+void printResult(const char *name, uint32_t bytes, uint32_t duration) {
+  Serial.print(name);
+  Serial.print(": avg ");
+  Serial.print(bytes / ITERATIONS);
+  Serial.print(" bytes, ");
+  Serial.print(duration);
+  Serial.print("us for ");
+  Serial.print(ITERATIONS);
+  Serial.println(" records");
+}
+
+void setup() {
+  uint32_t bytes;
+  uint32_t start;
+  bool ok;
+
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("\nTelemetry benchmark");
+
+  initSnapshot();
+  bytes = 0;
+  start = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    advanceSnapshot(i);
+    bytes += toJson(Snapshot).length();
+  }
+  printResult("JSON (String)", bytes, micros() - start);
+
+  initSnapshot();
+  bytes = 0;
+  start = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    advanceSnapshot(i);
+    bytes += EgoSmartHeaterTelemetry::encode(Buffer, sizeof(Buffer), EGO_SH_RS485_MODBUS_ADR, Snapshot);
+  }
+  printResult("binary full", bytes, micros() - start);
+
+  // delta records, checked by applying them to the receiver's copy
+  OperatingData_t received;
+  initSnapshot();
+  Previous = Snapshot;
+  received = Snapshot;
+  bytes = 0;
+  start = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    advanceSnapshot(i);
+    size_t len = EgoSmartHeaterTelemetry::encode(Buffer, sizeof(Buffer), EGO_SH_RS485_MODBUS_ADR, Snapshot, &Previous);
+    if (len > 0)
+      EgoSmartHeaterTelemetry::decode(Buffer, len, received);
+    Previous = Snapshot;
+    bytes += len;
+  }
+  printResult("binary delta + decode", bytes, micros() - start);
+
+  // the receiver's copy has to match the last snapshot
+  uint8_t expected[EGO_SH_TELEMETRY_MAX_RECORD];
+  size_t len = EgoSmartHeaterTelemetry::encode(expected, sizeof(expected), EGO_SH_RS485_MODBUS_ADR, Snapshot);
+  ok = EgoSmartHeaterTelemetry::encode(Buffer, sizeof(Buffer), EGO_SH_RS485_MODBUS_ADR, received) == len &&
+       memcmp(Buffer, expected, len) == 0;
+  Serial.println(ok ? "delta records verified" : "delta records differ");
+}
+
+void loop() {
+}
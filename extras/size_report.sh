@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# Flash and RAM cost of the build profiles and features of the library (see src/EgoSmartHeaterConfig.h).
+# Builds examples/SizeReport once per configuration with arduino-cli and prints the sizes reported by the core,
+# the features are measured on top of the control profile.
+#
+# Usage:   extras/size_report.sh [fqbn]        (default: esp8266:esp8266:nodemcuv2)
+# Example: extras/size_report.sh arduino:avr:mega
+#
+# Requires arduino-cli with the core of the board and the ModbusMaster library installed.
+# ARDUINO_CLI selects another arduino-cli binary.
+
+FQBN=${1:-esp8266:esp8266:nodemcuv2}
+CLI=${ARDUINO_CLI:-arduino-cli}
+LIBRARY=$(cd "$(dirname "$0")/.." && pwd)
+SKETCH="$LIBRARY/examples/SizeReport"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# build with the given flags, sets FLASH and RAM
+measure() {
+  OUTPUT=$("$CLI" compile --fqbn "$FQBN" --library "$LIBRARY" --build-path "$BUILD" --clean \
+    --build-property "compiler.cpp.extra_flags=$1" "$SKETCH" 2>&1)
+  if [ $? -ne 0 ]; then
+    echo "Build failed with flags $1:" >&2
+    echo "$OUTPUT" | tail -20 >&2
+    exit 1
+  fi
+  FLASH=$(echo "$OUTPUT" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+  RAM=$(echo "$OUTPUT" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+  if [ -z "$FLASH" ] || [ -z "$RAM" ]; then
+    echo "No size information in the output of $CLI for $FQBN" >&2
+    exit 1
+  fi
+}
+
+report() {
+  printf "%-36s %8s %8s %8s %8s\n" "$1" "$FLASH" "$RAM" "$2" "$3"
+}
+
+echo "Board: $FQBN"
+printf "%-36s %8s %8s %8s %8s\n" "Configuration" "Flash" "RAM" "+Flash" "+RAM"
+
+measure "-DEGO_SH_BUILD_PROFILE=1"
+BASE_FLASH=$FLASH
+BASE_RAM=$RAM
+report "control" "" ""
+
+for PROFILE in 2:telemetry 3:full; do
+  measure "-DEGO_SH_BUILD_PROFILE=${PROFILE%%:*}"
+  report "${PROFILE#*:}" $((FLASH - BASE_FLASH)) $((RAM - BASE_RAM))
+done
+
+feature() {
+  measure "-DEGO_SH_BUILD_PROFILE=1 $2"
+  report "control + $1" $((FLASH - BASE_FLASH)) $((RAM - BASE_RAM))
+}
+
+feature "TELEMETRY" "-DEGO_SH_FEATURE_TELEMETRY=1"
+feature "ERROR_LOG" "-DEGO_SH_FEATURE_ERROR_LOG=1"
+feature "SETUP" "-DEGO_SH_FEATURE_SETUP=1"
+feature "IDENTITY (with TELEMETRY)" "-DEGO_SH_FEATURE_TELEMETRY=1 -DEGO_SH_FEATURE_IDENTITY=1"
@@ -0,0 +1,159 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Power allocator for installations with several E.G.O. RS485 Smart Heaters.
+ * Spreads an available power surplus across the heaters in 500W steps.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterAllocator.h"
+#include <Arduino.h>
+
+static const uint16_t MaxTotalSteps = EGO_SH_ALLOC_MAX_HEATERS * EGO_SH_ALLOC_MAX_STEP;
+static const uint32_t CostInfinite = 0xFFFFFFFF;
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterAllocator::EgoSmartHeaterAllocator()
+{
+  _toggleCost = 4;
+  _cyclesPerCost = 16384;
+}
+
+void EgoSmartHeaterAllocator::setWearWeight(uint16_t toggleCost, uint32_t cyclesPerCost)
+{
+  _toggleCost = toggleCost;
+  _cyclesPerCost = cyclesPerCost;
+}
+
+/*
+ * Returns a bit mask of the steps (0..7) the heater may be switched to. Locked relais have to keep their current state.
+ * If the boiler reached TemperatureMaxValue only the locked relais remain on, since any other power would not be consumed.
+ */
+uint8_t EgoSmartHeaterAllocator::getAllowedSteps(const HeaterAllocationInput_t &heater)
+{
+  uint8_t current = heater.RelaisStatus & EGO_SH_ALLOC_MAX_STEP;
+  uint8_t locked = heater.RelaisLocked & EGO_SH_ALLOC_MAX_STEP;
+  bool hot = heater.TemperatureBoiler >= (int16_t)heater.TemperatureMaxValue;
+  uint8_t allowed = 0;
+
+  for (uint8_t s = 0; s <= EGO_SH_ALLOC_MAX_STEP; s++)
+  {
+    if ((s ^ current) & locked)
+      continue;
+    if (hot && (s & ~locked))
+      continue;
+    allowed |= (1 << s);
+  }
+  return allowed;
+}
+
+/*
+ * Every relais which has to change its state costs the base toggle cost plus a share depending on its switching cycles,
+ * so that less worn relais are preferred if several assignments result in the same power.
+ */
+uint32_t EgoSmartHeaterAllocator::getWearCost(const HeaterAllocationInput_t &heater, uint8_t step)
+{
+  uint8_t toggled = (heater.RelaisStatus ^ step) & EGO_SH_ALLOC_MAX_STEP;
+  uint32_t cost = 0;
+
+  for (int r = 0; r < 3; r++)
+  {
+    if (toggled & (1 << r))
+    {
+      cost += _toggleCost;
+      if (_cyclesPerCost > 0)
+        cost += heater.SwitchingCycles[r] / _cyclesPerCost;
+    }
+  }
+  return cost;
+}
+
+int32_t EgoSmartHeaterAllocator::allocate(int32_t surplus, const HeaterAllocationInput_t *heaters, uint8_t count, HeaterAllocation_t *result)
+{
+  uint32_t prev[MaxTotalSteps + 1];
+  uint32_t cur[MaxTotalSteps + 1];
+  uint32_t wear[EGO_SH_ALLOC_MAX_STEP + 1];
+  uint16_t maxSteps = 0;
+
+  if (count == 0 || count > EGO_SH_ALLOC_MAX_HEATERS)
+    return -1;
+
+  prev[0] = 0;
+
+  // dynamic program: prev[t] holds the minimum wear of the heaters processed so far using t steps in total
+  for (uint8_t h = 0; h < count; h++)
+  {
+    uint8_t allowed = getAllowedSteps(heaters[h]);
+
+    for (uint8_t s = 0; s <= EGO_SH_ALLOC_MAX_STEP; s++)
+    {
+      wear[s] = (allowed & (1 << s)) ? getWearCost(heaters[h], s) : CostInfinite;
+    }
+
+    for (uint16_t t = 0; t <= maxSteps + EGO_SH_ALLOC_MAX_STEP; t++)
+    {
+      cur[t] = CostInfinite;
+    }
+
+    for (uint16_t t = 0; t <= maxSteps; t++)
+    {
+      if (prev[t] == CostInfinite)
+        continue;
+      for (uint8_t s = 0; s <= EGO_SH_ALLOC_MAX_STEP; s++)
+      {
+        if (wear[s] == CostInfinite)
+          continue;
+        uint32_t c = prev[t] + wear[s];
+        if (c < cur[t + s])
+        {
+          cur[t + s] = c;
+          _choice[h][t + s] = s;
+        }
+      }
+    }
+
+    maxSteps += EGO_SH_ALLOC_MAX_STEP;
+    memcpy(prev, cur, (maxSteps + 1) * sizeof(uint32_t));
+  }
+
+  // select the total number of steps: the least export without exceeding the surplus, prev[t] is already the
+  // assignment with the least wear for this number of steps
+  uint16_t capSteps = 0;
+  if (surplus > 0)
+    capSteps = (surplus / EGO_SH_ALLOC_STEP_POWER > maxSteps) ? maxSteps : surplus / EGO_SH_ALLOC_STEP_POWER;
+
+  int best = -1;
+  for (int t = capSteps; t >= 0 && best < 0; t--)
+  {
+    if (prev[t] != CostInfinite)
+      best = t;
+  }
+
+  // locked relais might consume more than the surplus, take the smallest possible consumption in that case
+  for (int t = capSteps + 1; best < 0 && t <= maxSteps; t++)
+  {
+    if (prev[t] != CostInfinite)
+      best = t;
+  }
+
+  // trace back the assignment per heater
+  int t = best;
+  for (int h = count - 1; h >= 0; h--)
+  {
+    uint8_t s = _choice[h][t];
+    result[h].RelaisStatus = s;
+    result[h].PowerNominalValue = s * EGO_SH_ALLOC_STEP_POWER;
+    t -= s;
+  }
+  return (int32_t)best * EGO_SH_ALLOC_STEP_POWER;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Power allocator for installations with several E.G.O. RS485 Smart Heaters.
+ * Spreads an available power surplus across the heaters in 500W steps.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_ALLOCATOR_h
+#define EGO_SH_ALLOCATOR_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+//------------------------------------------------------------------------------
+#define EGO_SH_ALLOC_MAX_HEATERS 8      // Maximum number of heaters handled by one allocator
+#define EGO_SH_ALLOC_STEP_POWER 500     // Power of the smallest relais step in Watts
+#define EGO_SH_ALLOC_MAX_STEP 7         // Highest step (all three relais on: 3500W)
+
+//------------------------------------------------------------------------------
+
+/// \struct HeaterAllocationInput_t
+/// state of a single heater as seen by the allocator
+struct HeaterAllocationInput_t
+{
+  int16_t TemperatureBoiler;      // getActualTemperatureBoiler()
+  uint16_t TemperatureMaxValue;   // getTemperatureMaxValue()
+  uint16_t RelaisStatus;          // getRelaisStatus(), bit 0: 500W, bit 1: 1000W, bit 2: 2000W
+  uint8_t RelaisLocked;           // bit set if the relais must keep its state (MinOnTime / MinOffTime not yet elapsed)
+  uint32_t SwitchingCycles[3];    // SwitchingCycles of the three relais (see getRelaisConfiguration)
+};
+
+/// \struct HeaterAllocation_t
+/// assignment calculated for a single heater
+struct HeaterAllocation_t
+{
+  uint16_t RelaisStatus;          // target relais bitfield
+  int16_t PowerNominalValue;      // target power in Watts, to be applied by setPowerNominalValue()
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterAllocator
+/// Distributes a power surplus across several Smart Heaters.
+/// Every heater can be switched from 0W to 3500W in 500W steps, the step number directly equals the relais bitfield.
+/// The allocator minimises the exported power. Among the assignments with the least export it chooses the one with the
+/// least relais wear, so the wear never causes power to be exported. Heaters which reached their TemperatureMaxValue
+/// don't get any power assigned, locked relais keep their current state.
+/// The calculation is a dynamic program over the number of 500W steps and does not allocate any memory.
+class EgoSmartHeaterAllocator
+{
+public:
+  /// @brief Constructor to setup the allocator with default weights.
+  EgoSmartHeaterAllocator();
+
+  /// @brief Configure the cost of relais wear, which selects between assignments of the same total power.
+  /// @param toggleCost is the base cost of switching a single relais on or off (default: 4).
+  /// @param cyclesPerCost adds one cost unit for every cyclesPerCost SwitchingCycles a relais already performed (default: 16384, 0 = off).
+  void setWearWeight(uint16_t toggleCost, uint32_t cyclesPerCost);
+
+  /// @brief Calculate the relais assignment for all heaters.
+  /// @param surplus is the available power in Watts, including the power currently consumed by the heaters.
+  /// @param heaters is an array with the current state of every heater.
+  /// @param count is the number of heaters (max. EGO_SH_ALLOC_MAX_HEATERS).
+  /// @param result is an array of count elements which receives the assignment per heater.
+  /// @return Total power in Watts assigned to the heaters, -1 if count is out of range.
+  int32_t allocate(int32_t surplus, const HeaterAllocationInput_t *heaters, uint8_t count, HeaterAllocation_t *result);
+
+protected:
+  uint16_t _toggleCost;
+  uint32_t _cyclesPerCost;
+
+  // steps chosen for heater h when the heaters 0..h use t steps in total
+  uint8_t _choice[EGO_SH_ALLOC_MAX_HEATERS][EGO_SH_ALLOC_MAX_HEATERS * EGO_SH_ALLOC_MAX_STEP + 1];
+
+  uint8_t getAllowedSteps(const HeaterAllocationInput_t &heater);
+  uint32_t getWearCost(const HeaterAllocationInput_t &heater, uint8_t step);
+};
+
+#endif //EGO_SH_ALLOCATOR_h
@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Non-blocking modbus client for E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterAsyncClient.h"
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterAsyncClient::EgoSmartHeaterAsyncClient(int dere_pin)
+{
+  _derePin = dere_pin;
+}
+
+void EgoSmartHeaterAsyncClient::begin(Stream &serial)
+{
+  _serial = &serial;
+  _busy = false;
+  _cancelled = false;
+
+  if (_derePin >= 0)
+  {
+    pinMode(_derePin, OUTPUT);
+    digitalWrite(_derePin, 0);
+  }
+}
+
+void EgoSmartHeaterAsyncClient::setTimeout(uint16_t timeout)
+{
+  _timeout = timeout;
+}
+
+bool EgoSmartHeaterAsyncClient::readHoldingRegisters(uint8_t slave, uint16_t reg, uint16_t qty)
+{
+  if (_serial == NULL || _busy || qty == 0 || qty > EGO_SH_MAX_REGISTERS)
+    return false;
+
+  _slave = slave;
+  _function = EGO_SH_MODBUS_FC_READ_HOLDING;
+  _qty = qty;
+  send(EgoSmartHeaterModbusRtu::buildReadRequest(_frame, slave, reg, qty));
+  return true;
+}
+
+bool EgoSmartHeaterAsyncClient::writeMultipleRegisters(uint8_t slave, uint16_t reg, const uint16_t *values, uint16_t qty)
+{
+  if (_serial == NULL || _busy || qty == 0 || qty > EGO_SH_MAX_REGISTERS || qty > EGO_SH_MODBUS_MAX_WRITE)
+    return false;
+
+  _slave = slave;
+  _function = EGO_SH_MODBUS_FC_WRITE_MULTIPLE;
+  _qty = 0;
+  send(EgoSmartHeaterModbusRtu::buildWriteRequest(_frame, slave, reg, values, qty));
+  return true;
+}
+
+/*
+ * Anything left in the receive buffer belongs to an earlier, cancelled or timed out transaction and is dropped.
+ */
+void EgoSmartHeaterAsyncClient::send(size_t len)
+{
+  while (_serial->read() >= 0)
+    ;
+
+  if (_derePin >= 0)
+    digitalWrite(_derePin, 1);
+  _serial->write(_frame, len);
+  _serial->flush();
+  if (_derePin >= 0)
+    digitalWrite(_derePin, 0);
+
+  _busy = true;
+  _len = 0;
+  _expected = 0;
+  _start = millis();
+  _lastByte = _start;
+}
+
+/*
+ * The timeout applies to the first byte of the response, once the device answers the bytes have to follow within
+ * EGO_SH_ASYNC_BYTE_TIMEOUT.
+ */
+bool EgoSmartHeaterAsyncClient::poll()
+{
+  if (!_busy)
+    return false;
+
+  while (_serial->available() > 0)
+  {
+    int c = _serial->read();
+    if (c < 0)
+      break;
+    _lastByte = millis();
+    _frame[_len++] = c;
+    if (_len >= sizeof(_frame))
+    {
+      finish(ModbusMaster::ku8MBInvalidCRC);
+      return true;
+    }
+    _expected = EgoSmartHeaterModbusRtu::getResponseLength(_frame, _len);
+    if (_expected > 0 && _len >= _expected)
+    {
+      finish(_cancelled ? EGO_SH_RS485_CANCELLED : checkResponse());
+      return true;
+    }
+  }
+
+  if ((_len == 0 && millis() - _start > _timeout) || (_len > 0 && millis() - _lastByte > EGO_SH_ASYNC_BYTE_TIMEOUT))
+  {
+    finish(ModbusMaster::ku8MBResponseTimedOut);
+    return true;
+  }
+  return false;
+}
+
+/*
+ * A response arriving after the next request has been sent would be taken as its answer, so the transaction is only
+ * finished by poll(), once the response is complete or timed out.
+ */
+void EgoSmartHeaterAsyncClient::cancel()
+{
+  if (_busy)
+  {
+    _cancelled = true;
+    _result = EGO_SH_RS485_CANCELLED;
+    _qty = 0;
+  }
+}
+
+bool EgoSmartHeaterAsyncClient::isBusy()
+{
+  return _busy;
+}
+
+uint8_t EgoSmartHeaterAsyncClient::getResult()
+{
+  return _result;
+}
+
+uint16_t EgoSmartHeaterAsyncClient::getResponseBuffer(uint8_t i)
+{
+  return (i < _qty) ? _data[i] : 0;
+}
+
+void EgoSmartHeaterAsyncClient::finish(uint8_t result)
+{
+  _busy = false;
+  _result = _cancelled ? EGO_SH_RS485_CANCELLED : result;
+  _cancelled = false;
+  if (result != ModbusMaster::ku8MBSuccess)
+    _qty = 0;
+}
+
+uint8_t EgoSmartHeaterAsyncClient::checkResponse()
+{
+  if (!EgoSmartHeaterModbusRtu::checkCrc(_frame, _len))
+    return ModbusMaster::ku8MBInvalidCRC;
+  if (_frame[0] != _slave)
+    return ModbusMaster::ku8MBInvalidSlaveID;
+  if (_frame[1] & 0x80)
+    return _frame[2];
+  if (_frame[1] != _function)
+    return ModbusMaster::ku8MBInvalidFunction;
+  if (_function == EGO_SH_MODBUS_FC_READ_HOLDING)
+  {
+    if (_frame[2] != _qty * 2)
+      return ModbusMaster::ku8MBInvalidFunction;
+    for (uint16_t i = 0; i < _qty; i++)
+    {
+      _data[i] = (_frame[3 + 2 * i] << 8) | _frame[4 + 2 * i];
+    }
+  }
+  return ModbusMaster::ku8MBSuccess;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Non-blocking modbus client for E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_ASYNC_CLIENT_h
+#define EGO_SH_ASYNC_CLIENT_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#include "EgoSmartHeaterModbusRtu.h"
+//------------------------------------------------------------------------------
+#define EGO_SH_ASYNC_TIMEOUT 2000         // Default response timeout in milliseconds, same as ModbusMaster
+#define EGO_SH_ASYNC_BYTE_TIMEOUT 10      // Maximum gap between two bytes of a response in milliseconds
+#define EGO_SH_ASYNC_MAX_FRAME (9 + 2 * EGO_SH_MAX_REGISTERS)   // Largest request or response in bytes
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterAsyncClient
+/// Modbus RTU client which never waits for a response. A transaction is started by readHoldingRegisters or
+/// writeMultipleRegisters and completed by calling poll() until it returns true, e.g. once per loop() iteration.
+/// The result codes are the same as those of ModbusMaster, EGO_SH_RS485_CANCELLED if the transaction was cancelled.
+/// Only one transaction can be active per bus. The client talks to the bus directly, do not use an
+/// EgoSmartHeaterRS485 instance on the same bus at the same time.
+class EgoSmartHeaterAsyncClient
+{
+public:
+  /// @brief Constructor to setup the client in automatic or manual DE/RE control.
+  /// @param dere_pin is the number of the PIN which controls DE/RE of the MAX485 board (default: -1 = automatic).
+  EgoSmartHeaterAsyncClient(int dere_pin = -1);
+
+  /// @brief Attach the client to a bus.
+  /// @param serial is the serial interface of the bus.
+  void begin(Stream &serial);
+  /// @brief Configure the response timeout.
+  /// @param timeout is the time in milliseconds to wait for the first byte of a response (default: EGO_SH_ASYNC_TIMEOUT).
+  void setTimeout(uint16_t timeout);
+
+  /// @brief Send a Read Holding Registers request.
+  /// @param slave is the modbus address of the device.
+  /// @param reg is the first register.
+  /// @param qty is the number of registers (max. EGO_SH_MAX_REGISTERS of the build profile).
+  /// @return false if a transaction is active or the request is invalid.
+  bool readHoldingRegisters(uint8_t slave, uint16_t reg, uint16_t qty);
+  /// @brief Send a Write Multiple Registers request.
+  /// @param slave is the modbus address of the device.
+  /// @param reg is the first register.
+  /// @param values are the register values.
+  /// @param qty is the number of registers (max. EGO_SH_MAX_REGISTERS of the build profile and EGO_SH_MODBUS_MAX_WRITE).
+  /// @return false if a transaction is active or the request is invalid.
+  bool writeMultipleRegisters(uint8_t slave, uint16_t reg, const uint16_t *values, uint16_t qty);
+  /// @brief Receive the response of the active transaction as far as available.
+  /// @return true if the transaction finished with this call, the result is available by getResult().
+  bool poll();
+  /// @brief Abort the active transaction, its result is EGO_SH_RS485_CANCELLED. The device may still be answering on
+  /// the half-duplex bus, so the client stays busy until the response is received and dropped or the response timeout
+  /// has run out. Keep calling poll() until isBusy() returns false.
+  void cancel();
+
+  /// @return true if a transaction is active.
+  bool isBusy();
+  /// @return Result code of the last transaction (see ModBus libary).
+  uint8_t getResult();
+  /// @brief Retrieve a register of the last read.
+  /// @param i is the number of the register within the response.
+  /// @return Register value, 0 if i is out of range.
+  uint16_t getResponseBuffer(uint8_t i);
+
+protected:
+  Stream *_serial = NULL;
+  int _derePin;
+  uint16_t _timeout = EGO_SH_ASYNC_TIMEOUT;
+  bool _busy = false;
+  bool _cancelled = false;
+  uint8_t _result = ModbusMaster::ku8MBSuccess;
+  uint8_t _slave = 0;
+  uint8_t _function = 0;
+  uint16_t _qty = 0;
+  uint8_t _frame[EGO_SH_ASYNC_MAX_FRAME];
+  size_t _len = 0;
+  size_t _expected = 0;
+  unsigned long _start = 0;
+  unsigned long _lastByte = 0;
+  uint16_t _data[EGO_SH_MAX_REGISTERS];
+
+  void send(size_t len);
+  void finish(uint8_t result);
+  uint8_t checkResponse();
+};
+
+#endif //EGO_SH_ASYNC_CLIENT_h
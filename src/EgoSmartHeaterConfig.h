@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Build profiles of the library for E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_CONFIG_h
+#define EGO_SH_CONFIG_h
+//------------------------------------------------------------------------------
+// The profile and the features are selected by compiler flags, since a #define in the sketch doesn't reach the
+// library sources, e.g. -DEGO_SH_BUILD_PROFILE=1 in build_flags of PlatformIO or
+// arduino-cli compile --build-property "compiler.cpp.extra_flags=-DEGO_SH_BUILD_PROFILE=1".
+// Every feature can be switched on (1) or off (0) separately, overriding the profile.
+//------------------------------------------------------------------------------
+#define EGO_SH_BUILD_CONTROL 1          // power and temperature control only
+#define EGO_SH_BUILD_TELEMETRY 2        // control, operating data and error log
+#define EGO_SH_BUILD_FULL 3             // all functions (default)
+
+#ifndef EGO_SH_BUILD_PROFILE
+#define EGO_SH_BUILD_PROFILE EGO_SH_BUILD_FULL
+#endif
+
+// operating data, relais configuration and operating times, EgoSmartHeaterTelemetry
+#ifndef EGO_SH_FEATURE_TELEMETRY
+#define EGO_SH_FEATURE_TELEMETRY (EGO_SH_BUILD_PROFILE >= EGO_SH_BUILD_TELEMETRY)
+#endif
+// error log (getError, getErrorLog)
+#ifndef EGO_SH_FEATURE_ERROR_LOG
+#define EGO_SH_FEATURE_ERROR_LOG (EGO_SH_BUILD_PROFILE >= EGO_SH_BUILD_TELEMETRY)
+#endif
+// identity strings, device profile, EgoSmartHeaterProfileStore and EgoSmartHeaterDiscovery
+#ifndef EGO_SH_FEATURE_IDENTITY
+#define EGO_SH_FEATURE_IDENTITY (EGO_SH_BUILD_PROFILE >= EGO_SH_BUILD_FULL)
+#endif
+// setters of single temperatures and of the relais switching times
+#ifndef EGO_SH_FEATURE_SETUP
+#define EGO_SH_FEATURE_SETUP (EGO_SH_BUILD_PROFILE >= EGO_SH_BUILD_FULL)
+#endif
+
+#if EGO_SH_FEATURE_IDENTITY && !EGO_SH_FEATURE_TELEMETRY
+#error "EGO_SH_FEATURE_IDENTITY requires EGO_SH_FEATURE_TELEMETRY, the device profile contains the relais configuration"
+#endif
+
+// Largest transaction buffered by the non-blocking client (EgoSmartHeaterAsyncClient), in registers
+#ifndef EGO_SH_MAX_REGISTERS
+#if EGO_SH_FEATURE_IDENTITY
+#define EGO_SH_MAX_REGISTERS 125        // any modbus read
+#elif EGO_SH_FEATURE_ERROR_LOG
+#define EGO_SH_MAX_REGISTERS 40         // error log
+#elif EGO_SH_FEATURE_TELEMETRY
+#define EGO_SH_MAX_REGISTERS 15         // operating data
+#else
+#define EGO_SH_MAX_REGISTERS 8          // temperature configuration, power
+#endif
+#endif
+
+#endif //EGO_SH_CONFIG_h
@@ -0,0 +1,568 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * C++20 coroutine interface for E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterCoroutine.h"
+#if defined(EGO_SH_COROUTINES)
+#include "EgoSmartHeaterDecoder.h"
+
+static const uint8_t StateIdle = 0;
+static const uint8_t StateQueued = 1;    // waiting for the bus or the timer
+static const uint8_t StateActive = 2;    // sent, waiting for the response
+static const uint8_t StateReady = 3;     // finished, task not resumed yet
+
+static const uint16_t RegisterTemperatureMinValue = 0x1209;
+static const uint16_t RegisterPowerNominalValue = 0x1300;
+static const uint16_t RegisterActualTemperatureBoiler = 0x1404;
+static const uint16_t RegisterUserTemperatureNominal = 0x1407;
+static const uint16_t RegisterRelaisStatus = 0x1408;
+static const uint16_t RegisterOperatingSecondsRelais1 = 0x1409;
+
+typedef std::coroutine_handle<EgoSmartHeaterTask::promise_type> TaskHandle_t;
+
+static void unlink(AsyncOperation_t *&head, AsyncOperation_t **tail, AsyncOperation_t &op)
+{
+  AsyncOperation_t *prev = NULL;
+
+  for (AsyncOperation_t *o = head; o != NULL; prev = o, o = o->Next)
+  {
+    if (o == &op)
+    {
+      if (prev != NULL)
+        prev->Next = o->Next;
+      else
+        head = o->Next;
+      if (tail != NULL && *tail == o)
+        *tail = prev;
+      break;
+    }
+  }
+  op.Next = NULL;
+}
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterTask::EgoSmartHeaterTask(std::coroutine_handle<promise_type> handle)
+{
+  _handle = handle;
+}
+
+EgoSmartHeaterTask::EgoSmartHeaterTask(EgoSmartHeaterTask &&other) noexcept
+{
+  _handle = other._handle;
+  other._handle = nullptr;
+}
+
+EgoSmartHeaterTask &EgoSmartHeaterTask::operator=(EgoSmartHeaterTask &&other) noexcept
+{
+  if (this != &other)
+  {
+    destroy();
+    _handle = other._handle;
+    other._handle = nullptr;
+  }
+  return *this;
+}
+
+EgoSmartHeaterTask::~EgoSmartHeaterTask()
+{
+  destroy();
+}
+
+void EgoSmartHeaterTask::destroy()
+{
+  if (!_handle)
+    return;
+  if (_handle.promise().Loop != NULL)
+    _handle.promise().Loop->detach(_handle.promise());
+  _handle.destroy();
+  _handle = nullptr;
+}
+
+bool EgoSmartHeaterTask::isDone()
+{
+  return !_handle || _handle.done();
+}
+
+bool EgoSmartHeaterTask::isCancelled()
+{
+  return _handle && _handle.promise().Cancelled;
+}
+
+void EgoSmartHeaterTask::cancel()
+{
+  if (isDone())
+    return;
+  if (_handle.promise().Loop != NULL)
+    _handle.promise().Loop->cancel(_handle.promise());
+  else
+    _handle.promise().Cancelled = true;
+}
+
+//------------------------------------------------------------------------------
+/*
+ * The internal buffer is assigned when the operation is awaited, so the awaitable can be returned by value.
+ */
+EgoSmartHeaterOperation::EgoSmartHeaterOperation(EgoSmartHeaterEventLoop &loop, int8_t bus, uint8_t slave, uint8_t function,
+                                                 uint16_t reg, uint16_t qty, uint16_t *data)
+{
+  _loop = &loop;
+  _op.Next = NULL;
+  _op.Handle = nullptr;
+  _op.Task = NULL;
+  _op.Bus = bus;
+  _op.State = StateIdle;
+  _op.Slave = slave;
+  _op.Function = function;
+  _op.Register = reg;
+  _op.Quantity = qty;
+  _op.Data = data;
+  _op.WakeTime = 0;
+  _op.Result = ModbusMaster::ku8MBSuccess;
+  _internal = (data == NULL);
+
+  if ((function != 0 && bus < 0) || (_internal && qty > EGO_SH_AWAIT_MAX_VALUES))
+    refuse(EGO_SH_RS485_INVALID_VALUE);
+}
+
+void EgoSmartHeaterOperation::refuse(uint8_t result)
+{
+  _op.Result = result;
+  _ready = true;
+}
+
+uint16_t *EgoSmartHeaterOperation::getBuffer()
+{
+  return _data;
+}
+
+bool EgoSmartHeaterOperation::await_ready()
+{
+  return _ready;
+}
+
+/*
+ * A cancelled task doesn't send anything anymore, the operation returns immediately without suspending the task.
+ */
+bool EgoSmartHeaterOperation::await_suspend(std::coroutine_handle<EgoSmartHeaterTask::promise_type> handle)
+{
+  EgoSmartHeaterTask::promise_type &task = handle.promise();
+
+  if (_internal)
+    _op.Data = _data;
+  if (task.Cancelled)
+  {
+    _op.Result = EGO_SH_RS485_CANCELLED;
+    return false;
+  }
+  if (task.Loop != _loop || _op.Bus >= _loop->_busCount)
+  {
+    _op.Result = EGO_SH_RS485_INVALID_VALUE;
+    return false;
+  }
+
+  _op.Handle = handle;
+  _op.Task = &task;
+  task.Current = &_op;
+  _loop->enqueue(_op);
+  return true;
+}
+
+uint8_t EgoSmartHeaterOperation::await_resume()
+{
+  return _op.Result;
+}
+
+//------------------------------------------------------------------------------
+int EgoSmartHeaterEventLoop::addBus(EgoSmartHeaterAsyncClient &client)
+{
+  if (_busCount >= EGO_SH_LOOP_MAX_BUSES)
+    return -1;
+
+  Bus_t &bus = _bus[_busCount];
+  bus.Client = &client;
+  bus.Head = NULL;
+  bus.Tail = NULL;
+  bus.Active = NULL;
+  bus.Cancelling = false;
+  return _busCount++;
+}
+
+void EgoSmartHeaterEventLoop::spawn(EgoSmartHeaterTask &task, uint32_t timeout)
+{
+  if (task.isDone() || task._handle.promise().Loop != NULL)
+    return;
+
+  EgoSmartHeaterTask::promise_type &promise = task._handle.promise();
+  promise.Loop = this;
+  promise.Started = false;
+  promise.HasDeadline = (timeout > 0);
+  promise.Deadline = millis() + timeout;
+  promise.Next = _tasks;
+  _tasks = &promise;
+}
+
+EgoSmartHeaterOperation EgoSmartHeaterEventLoop::sleep(uint32_t ms)
+{
+  EgoSmartHeaterOperation timer(*this, -1, 0, 0, 0, 0, NULL);
+
+  timer._op.WakeTime = ms;
+  return timer;
+}
+
+/*
+ * The tasks are resumed in the order their operations finished. A resumed task only queues its next operation,
+ * the bus transactions are started by the next step(), so a task can't starve the others.
+ */
+bool EgoSmartHeaterEventLoop::step()
+{
+  uint32_t now = millis();
+  bool progress = false;
+  EgoSmartHeaterTask::promise_type *task;
+
+  for (task = _tasks; task != NULL; task = task->Next)
+  {
+    if (task->HasDeadline && !task->Cancelled && (int32_t)(now - task->Deadline) >= 0)
+      cancel(*task);
+  }
+  for (task = _tasks; task != NULL; task = task->Next)
+  {
+    if (!task->Started)
+    {
+      task->Started = true;
+      TaskHandle_t::from_promise(*task).resume();
+      progress = true;
+    }
+  }
+
+  for (uint8_t b = 0; b < _busCount; b++)
+  {
+    if (serveBus(_bus[b]))
+      progress = true;
+  }
+
+  AsyncOperation_t **link = &_timers;
+  while (*link != NULL)
+  {
+    AsyncOperation_t *op = *link;
+    if ((int32_t)(now - op->WakeTime) >= 0)
+    {
+      *link = op->Next;
+      complete(*op, ModbusMaster::ku8MBSuccess);
+      progress = true;
+    }
+    else
+      link = &op->Next;
+  }
+
+  while (_readyHead != NULL)
+  {
+    AsyncOperation_t *op = _readyHead;
+    _readyHead = op->Next;
+    if (_readyHead == NULL)
+      _readyTail = NULL;
+    op->Next = NULL;
+    op->State = StateIdle;
+    ((EgoSmartHeaterTask::promise_type *)op->Task)->Current = NULL;
+    op->Handle.resume();    // the operation may not exist anymore afterwards
+    progress = true;
+  }
+
+  EgoSmartHeaterTask::promise_type **next = &_tasks;
+  while (*next != NULL)
+  {
+    task = *next;
+    if (TaskHandle_t::from_promise(*task).done())
+    {
+      *next = task->Next;
+      task->Next = NULL;
+      task->Loop = NULL;
+    }
+    else
+      next = &task->Next;
+  }
+
+  _progress = progress;
+  return _tasks != NULL;
+}
+
+void EgoSmartHeaterEventLoop::run()
+{
+  while (step())
+  {
+    if (!_progress)
+      delay(1);
+  }
+}
+
+uint8_t EgoSmartHeaterEventLoop::getTaskCount()
+{
+  uint8_t count = 0;
+
+  for (EgoSmartHeaterTask::promise_type *task = _tasks; task != NULL; task = task->Next)
+    count++;
+  return count;
+}
+
+void EgoSmartHeaterEventLoop::enqueue(AsyncOperation_t &op)
+{
+  op.Next = NULL;
+  op.State = StateQueued;
+
+  if (op.Bus < 0)
+  {
+    op.WakeTime += millis();
+    op.Next = _timers;
+    _timers = &op;
+    return;
+  }
+
+  Bus_t &bus = _bus[op.Bus];
+  if (bus.Tail != NULL)
+    bus.Tail->Next = &op;
+  else
+    bus.Head = &op;
+  bus.Tail = &op;
+}
+
+/*
+ * An operation which already finished keeps its result, the cancellation applies to the following operations.
+ */
+void EgoSmartHeaterEventLoop::cancel(EgoSmartHeaterTask::promise_type &task)
+{
+  if (task.Cancelled)
+    return;
+  task.Cancelled = true;
+
+  AsyncOperation_t *op = task.Current;
+  if (op != NULL && op->State != StateReady)
+  {
+    remove(*op);
+    complete(*op, EGO_SH_RS485_CANCELLED);
+  }
+}
+
+void EgoSmartHeaterEventLoop::detach(EgoSmartHeaterTask::promise_type &task)
+{
+  if (task.Current != NULL)
+    remove(*task.Current);
+  task.Current = NULL;
+
+  for (EgoSmartHeaterTask::promise_type **next = &_tasks; *next != NULL; next = &(*next)->Next)
+  {
+    if (*next == &task)
+    {
+      *next = task.Next;
+      break;
+    }
+  }
+  task.Next = NULL;
+  task.Loop = NULL;
+}
+
+void EgoSmartHeaterEventLoop::remove(AsyncOperation_t &op)
+{
+  switch (op.State)
+  {
+    case StateQueued:
+      if (op.Bus < 0)
+        unlink(_timers, NULL, op);
+      else
+        unlink(_bus[op.Bus].Head, &_bus[op.Bus].Tail, op);
+      break;
+    case StateActive:
+      _bus[op.Bus].Client->cancel();
+      _bus[op.Bus].Active = NULL;
+      _bus[op.Bus].Cancelling = true;
+      break;
+    case StateReady:
+      unlink(_readyHead, &_readyTail, op);
+      break;
+  }
+  op.State = StateIdle;
+}
+
+void EgoSmartHeaterEventLoop::complete(AsyncOperation_t &op, uint8_t result)
+{
+  op.Result = result;
+  op.State = StateReady;
+  op.Next = NULL;
+  if (_readyTail != NULL)
+    _readyTail->Next = &op;
+  else
+    _readyHead = &op;
+  _readyTail = &op;
+}
+
+/*
+ * The bus may be used by the application directly while the loop has nothing to send, the next operation waits until
+ * the client is idle. After a cancelled operation the bus stays blocked until its response is received or timed out.
+ */
+bool EgoSmartHeaterEventLoop::serveBus(Bus_t &bus)
+{
+  bool progress = false;
+
+  if (bus.Cancelling && (bus.Client->poll() || !bus.Client->isBusy()))
+  {
+    bus.Cancelling = false;
+    progress = true;
+  }
+
+  if (bus.Active != NULL && bus.Client->poll())
+  {
+    AsyncOperation_t &op = *bus.Active;
+    bus.Active = NULL;
+    if (op.Function == EGO_SH_MODBUS_FC_READ_HOLDING && bus.Client->getResult() == ModbusMaster::ku8MBSuccess)
+    {
+      for (uint16_t i = 0; i < op.Quantity; i++)
+        op.Data[i] = bus.Client->getResponseBuffer(i);
+    }
+    complete(op, bus.Client->getResult());
+    progress = true;
+  }
+
+  if (bus.Active == NULL && bus.Head != NULL && !bus.Client->isBusy())
+  {
+    AsyncOperation_t &op = *bus.Head;
+    bool started;
+
+    unlink(bus.Head, &bus.Tail, op);
+    if (op.Function == EGO_SH_MODBUS_FC_READ_HOLDING)
+      started = bus.Client->readHoldingRegisters(op.Slave, op.Register, op.Quantity);
+    else
+      started = bus.Client->writeMultipleRegisters(op.Slave, op.Register, op.Data, op.Quantity);
+    if (started)
+    {
+      op.State = StateActive;
+      bus.Active = &op;
+    }
+    else
+      complete(op, EGO_SH_RS485_INVALID_VALUE);
+    progress = true;
+  }
+  return progress;
+}
+
+//------------------------------------------------------------------------------
+static int16_t decodeInt16(const uint16_t *data)
+{
+  return data[0];
+}
+
+static uint16_t decodeUint16(const uint16_t *data)
+{
+  return data[0];
+}
+
+static TemperatureConfig_t decodeTemperatureConfig(const uint16_t *data)
+{
+  TemperatureConfig_t config;
+
+  config.TemperatureMinValue = data[0];
+  config.TemperatureMaxValue = data[1];
+  config.TemperatureNominalValue = data[2];
+  return config;
+}
+
+static RelaisOperatingTime_t decodeRelaisOperatingTime(const uint16_t *data)
+{
+  RelaisOperatingTime_t time;
+
+  time.OperatingSeconds1 = EgoSmartHeaterDecoder::toUint32(data[0], data[1]);
+  time.OperatingSeconds2 = EgoSmartHeaterDecoder::toUint32(data[2], data[3]);
+  time.OperatingSeconds3 = EgoSmartHeaterDecoder::toUint32(data[4], data[5]);
+  return time;
+}
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterAsync::EgoSmartHeaterAsync(EgoSmartHeaterEventLoop &loop, int bus, uint8_t slave)
+{
+  _loop = &loop;
+  _bus = bus;
+  _slave = slave;
+}
+
+EgoSmartHeaterOperation EgoSmartHeaterAsync::readRegisters(uint16_t reg, uint16_t qty, uint16_t *data)
+{
+  return EgoSmartHeaterOperation(*_loop, _bus, _slave, EGO_SH_MODBUS_FC_READ_HOLDING, reg, qty, data);
+}
+
+EgoSmartHeaterOperation EgoSmartHeaterAsync::writeRegisters(uint16_t reg, const uint16_t *values, uint16_t qty)
+{
+  EgoSmartHeaterOperation operation(*_loop, _bus, _slave, EGO_SH_MODBUS_FC_WRITE_MULTIPLE, reg, qty, NULL);
+
+  if (qty <= EGO_SH_AWAIT_MAX_VALUES)
+    memcpy(operation.getBuffer(), values, qty * sizeof(uint16_t));
+  return operation;
+}
+
+EgoSmartHeaterValue<int16_t> EgoSmartHeaterAsync::getActualTemperatureBoiler()
+{
+  return EgoSmartHeaterValue<int16_t>(*_loop, _bus, _slave, RegisterActualTemperatureBoiler, 1, decodeInt16);
+}
+
+EgoSmartHeaterValue<uint16_t> EgoSmartHeaterAsync::getRelaisStatus()
+{
+  return EgoSmartHeaterValue<uint16_t>(*_loop, _bus, _slave, RegisterRelaisStatus, 1, decodeUint16);
+}
+
+EgoSmartHeaterValue<int16_t> EgoSmartHeaterAsync::getUserTemperatureNominal()
+{
+  return EgoSmartHeaterValue<int16_t>(*_loop, _bus, _slave, RegisterUserTemperatureNominal, 1, decodeInt16);
+}
+
+EgoSmartHeaterValue<int16_t> EgoSmartHeaterAsync::getPowerNominalValue()
+{
+  return EgoSmartHeaterValue<int16_t>(*_loop, _bus, _slave, RegisterPowerNominalValue, 1, decodeInt16);
+}
+
+EgoSmartHeaterValue<TemperatureConfig_t> EgoSmartHeaterAsync::getTemperatureConfig()
+{
+  return EgoSmartHeaterValue<TemperatureConfig_t>(*_loop, _bus, _slave, RegisterTemperatureMinValue, 3, decodeTemperatureConfig);
+}
+
+EgoSmartHeaterValue<RelaisOperatingTime_t> EgoSmartHeaterAsync::getRelaisOperatingTime()
+{
+  return EgoSmartHeaterValue<RelaisOperatingTime_t>(*_loop, _bus, _slave, RegisterOperatingSecondsRelais1, 6, decodeRelaisOperatingTime);
+}
+
+EgoSmartHeaterOperation EgoSmartHeaterAsync::setPowerNominalValue(int16_t value)
+{
+  uint16_t data = value;
+
+  return writeRegisters(RegisterPowerNominalValue, &data, 1);
+}
+
+EgoSmartHeaterOperation EgoSmartHeaterAsync::setTemperatureConfig(const TemperatureConfig_t &config, int16_t userTemperatureNominal)
+{
+  uint16_t data[3] = {config.TemperatureMinValue, config.TemperatureMaxValue, config.TemperatureNominalValue};
+  EgoSmartHeaterOperation operation = writeRegisters(RegisterTemperatureMinValue, data, 3);
+
+  if (!EgoSmartHeaterRS485::checkTemperatureConfig(config, userTemperatureNominal))
+    operation.refuse(EGO_SH_RS485_INVALID_VALUE);
+  return operation;
+}
+
+int EgoSmartHeaterAsync::getBus()
+{
+  return _bus;
+}
+
+uint8_t EgoSmartHeaterAsync::getSlaveId()
+{
+  return _slave;
+}
+
+#endif //EGO_SH_COROUTINES
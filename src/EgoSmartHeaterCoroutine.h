@@ -0,0 +1,276 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * C++20 coroutine interface for E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_COROUTINE_h
+#define EGO_SH_COROUTINE_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#include "EgoSmartHeaterAsyncClient.h"
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define EGO_SH_COROUTINES               // compiled as C++20 with coroutine support
+#include <coroutine>
+#endif
+#endif
+
+#if defined(EGO_SH_COROUTINES)
+//------------------------------------------------------------------------------
+#define EGO_SH_LOOP_MAX_BUSES 8         // Maximum number of buses of an event loop
+#define EGO_SH_AWAIT_MAX_VALUES 8       // Registers buffered by an awaitable operation
+
+//------------------------------------------------------------------------------
+class EgoSmartHeaterEventLoop;
+
+/// \struct AsyncOperation_t
+/// bus transaction or timer a task is waiting for, queued by EgoSmartHeaterEventLoop
+struct AsyncOperation_t
+{
+  AsyncOperation_t *Next;
+  std::coroutine_handle<> Handle;  // waiting task
+  void *Task;                      // promise of the waiting task
+  int8_t Bus;                      // -1 = timer
+  uint8_t State;
+  uint8_t Slave;
+  uint8_t Function;
+  uint16_t Register;
+  uint16_t Quantity;
+  uint16_t *Data;
+  uint32_t WakeTime;               // delay until the operation is awaited, then millis() to wake up
+  uint8_t Result;
+};
+
+/// \struct AsyncResult_t
+/// result code and value of an awaited read, Value is zero if ErrCode is not ku8MBSuccess
+template <typename T>
+struct AsyncResult_t
+{
+  uint8_t ErrCode;
+  T Value;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterTask
+/// Coroutine returned by a sequence of awaited heater operations, e.g.
+///   EgoSmartHeaterTask boost(EgoSmartHeaterAsync &heater) { co_await heater.setPowerNominalValue(500); ... }
+/// The task is started by EgoSmartHeaterEventLoop::spawn and owns the coroutine frame, so it has to live until the
+/// task is done. Destroying a task which is still running detaches it from the loop.
+class EgoSmartHeaterTask
+{
+public:
+  struct promise_type
+  {
+    EgoSmartHeaterEventLoop *Loop = NULL;
+    promise_type *Next = NULL;
+    AsyncOperation_t *Current = NULL;
+    bool Started = false;
+    bool Cancelled = false;
+    bool HasDeadline = false;
+    uint32_t Deadline = 0;
+
+    EgoSmartHeaterTask get_return_object()
+    {
+      return EgoSmartHeaterTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+
+  EgoSmartHeaterTask(EgoSmartHeaterTask &&other) noexcept;
+  EgoSmartHeaterTask &operator=(EgoSmartHeaterTask &&other) noexcept;
+  EgoSmartHeaterTask(const EgoSmartHeaterTask &) = delete;
+  EgoSmartHeaterTask &operator=(const EgoSmartHeaterTask &) = delete;
+  ~EgoSmartHeaterTask();
+
+  /// @return true if the coroutine ran to its end.
+  bool isDone();
+  /// @return true if the task was cancelled, by cancel() or its timeout.
+  bool isCancelled();
+  /// @brief Cancel the task. The pending operation and all following ones return EGO_SH_RS485_CANCELLED without
+  /// accessing the bus, the coroutine runs to its end with the next steps of the loop.
+  void cancel();
+
+protected:
+  std::coroutine_handle<promise_type> _handle;
+
+  explicit EgoSmartHeaterTask(std::coroutine_handle<promise_type> handle);
+  void destroy();
+  friend class EgoSmartHeaterEventLoop;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterOperation
+/// Awaitable bus transaction or timer, co_await returns the result code (see ModBus libary).
+class EgoSmartHeaterOperation
+{
+public:
+  EgoSmartHeaterOperation(EgoSmartHeaterEventLoop &loop, int8_t bus, uint8_t slave, uint8_t function, uint16_t reg,
+                          uint16_t qty, uint16_t *data);
+
+  /// @brief Refuse the operation before it is sent, co_await returns the result immediately.
+  void refuse(uint8_t result);
+  /// @return Internal buffer for the register values of a write, or the response of a read without data buffer.
+  uint16_t *getBuffer();
+
+  bool await_ready();
+  bool await_suspend(std::coroutine_handle<EgoSmartHeaterTask::promise_type> handle);
+  uint8_t await_resume();
+
+protected:
+  EgoSmartHeaterEventLoop *_loop;
+  AsyncOperation_t _op;
+  bool _internal;
+  bool _ready = false;
+  uint16_t _data[EGO_SH_AWAIT_MAX_VALUES];
+
+  friend class EgoSmartHeaterEventLoop;
+};
+
+/// \class EgoSmartHeaterValue
+/// Awaitable read, co_await returns AsyncResult_t with the decoded value.
+template <typename T>
+class EgoSmartHeaterValue : public EgoSmartHeaterOperation
+{
+public:
+  typedef T (*Decode_t)(const uint16_t *data);
+
+  EgoSmartHeaterValue(EgoSmartHeaterEventLoop &loop, int8_t bus, uint8_t slave, uint16_t reg, uint16_t qty, Decode_t decode)
+      : EgoSmartHeaterOperation(loop, bus, slave, EGO_SH_MODBUS_FC_READ_HOLDING, reg, qty, NULL), _decode(decode)
+  {
+  }
+
+  AsyncResult_t<T> await_resume()
+  {
+    AsyncResult_t<T> result;
+    result.ErrCode = EgoSmartHeaterOperation::await_resume();
+    result.Value = (result.ErrCode == ModbusMaster::ku8MBSuccess) ? _decode(_data) : T();
+    return result;
+  }
+
+protected:
+  Decode_t _decode;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterEventLoop
+/// Single threaded scheduler of EgoSmartHeaterTask coroutines. Every bus is served by an EgoSmartHeaterAsyncClient,
+/// the operations of all tasks on a bus are queued and sent one after another, while the buses work in parallel.
+/// step() never blocks, it can be called from loop() next to other code; run() calls it until all tasks are done.
+class EgoSmartHeaterEventLoop
+{
+public:
+  /// @brief Add a bus served by the loop.
+  /// @param client is the non-blocking client of the bus, begin() has to be called by the caller.
+  /// @return Number of the bus, -1 if EGO_SH_LOOP_MAX_BUSES is exceeded.
+  int addBus(EgoSmartHeaterAsyncClient &client);
+  /// @brief Start a task with the next step().
+  /// @param task is the coroutine, it has to live until it is done.
+  /// @param timeout cancels the task after the given time in milliseconds (default: 0 = no timeout).
+  void spawn(EgoSmartHeaterTask &task, uint32_t timeout = 0);
+  /// @brief Awaitable delay, co_await returns ku8MBSuccess or EGO_SH_RS485_CANCELLED.
+  /// @param ms is the delay in milliseconds.
+  EgoSmartHeaterOperation sleep(uint32_t ms);
+
+  /// @brief Serve the buses and timers and resume the tasks whose operations finished.
+  /// @return true if tasks are left.
+  bool step();
+  /// @brief Call step() until all tasks are done.
+  void run();
+  /// @return Number of tasks not done yet.
+  uint8_t getTaskCount();
+
+protected:
+  struct Bus_t
+  {
+    EgoSmartHeaterAsyncClient *Client;
+    AsyncOperation_t *Head;
+    AsyncOperation_t *Tail;
+    AsyncOperation_t *Active;
+    bool Cancelling;            // the client waits for the end of a cancelled transaction
+  };
+
+  Bus_t _bus[EGO_SH_LOOP_MAX_BUSES];
+  uint8_t _busCount = 0;
+  AsyncOperation_t *_timers = NULL;
+  AsyncOperation_t *_readyHead = NULL;
+  AsyncOperation_t *_readyTail = NULL;
+  EgoSmartHeaterTask::promise_type *_tasks = NULL;
+  bool _progress = false;
+
+  void enqueue(AsyncOperation_t &op);
+  void cancel(EgoSmartHeaterTask::promise_type &task);
+  void detach(EgoSmartHeaterTask::promise_type &task);
+  void remove(AsyncOperation_t &op);
+  void complete(AsyncOperation_t &op, uint8_t result);
+  bool serveBus(Bus_t &bus);
+
+  friend class EgoSmartHeaterTask;
+  friend class EgoSmartHeaterOperation;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterAsync
+/// Awaitable versions of the EgoSmartHeaterRS485 operations of a heater on a bus of an EgoSmartHeaterEventLoop.
+/// Several tasks may use the same heater, their operations are sent in the order they are awaited.
+class EgoSmartHeaterAsync
+{
+public:
+  /// @brief Constructor to setup a heater.
+  /// @param loop is the event loop serving the bus.
+  /// @param bus is the number returned by EgoSmartHeaterEventLoop::addBus.
+  /// @param slave is the modbus address of the heater (default: EGO_SH_RS485_MODBUS_ADR).
+  EgoSmartHeaterAsync(EgoSmartHeaterEventLoop &loop, int bus, uint8_t slave = EGO_SH_RS485_MODBUS_ADR);
+
+  /// @brief Read registers into a buffer of the caller.
+  EgoSmartHeaterOperation readRegisters(uint16_t reg, uint16_t qty, uint16_t *data);
+  /// @brief Write registers, the values are copied (max. EGO_SH_AWAIT_MAX_VALUES).
+  EgoSmartHeaterOperation writeRegisters(uint16_t reg, const uint16_t *values, uint16_t qty);
+
+  /// @brief Read actual boiler temperature (0x1404)
+  EgoSmartHeaterValue<int16_t> getActualTemperatureBoiler();
+  /// @brief Read relais status (0x1408)
+  EgoSmartHeaterValue<uint16_t> getRelaisStatus();
+  /// @brief Read potentiometer setting (0x1407)
+  EgoSmartHeaterValue<int16_t> getUserTemperatureNominal();
+  /// @brief Read power nominal value (0x1300)
+  EgoSmartHeaterValue<int16_t> getPowerNominalValue();
+  /// @brief Read temperature configuration block (0x1209 - 0x120B)
+  EgoSmartHeaterValue<TemperatureConfig_t> getTemperatureConfig();
+  /// @brief Read operating seconds of all relais (0x1409 - 0x140E)
+  EgoSmartHeaterValue<RelaisOperatingTime_t> getRelaisOperatingTime();
+
+  /// @brief Write power nominal value (0x1300), has to be renewed within 60 seconds like EgoSmartHeaterRS485::setPowerNominalValue
+  EgoSmartHeaterOperation setPowerNominalValue(int16_t value);
+  /// @brief Write temperature configuration block (0x1209 - 0x120B)
+  /// The configuration is checked by EgoSmartHeaterRS485::checkTemperatureConfig, EGO_SH_RS485_INVALID_VALUE if it is refused.
+  EgoSmartHeaterOperation setTemperatureConfig(const TemperatureConfig_t &config, int16_t userTemperatureNominal);
+
+  /// @return Number of the bus of the heater.
+  int getBus();
+  /// @return Modbus address of the heater.
+  uint8_t getSlaveId();
+
+protected:
+  EgoSmartHeaterEventLoop *_loop;
+  int8_t _bus;
+  uint8_t _slave;
+};
+
+#endif //EGO_SH_COROUTINES
+#endif //EGO_SH_COROUTINE_h
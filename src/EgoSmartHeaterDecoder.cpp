@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Decoding of modbus register values of E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterDecoder.h"
+#include <Arduino.h>
+
+static const uint8_t TypeRegisters[] = {1, 1, 2, 2, 2, 16};
+
+//------------------------------------------------------------------------------
+void EgoSmartHeaterDecoder::toChars(const uint16_t *data, uint8_t count, char *text)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    text[2 * i] = data[i] & 0xFF;
+    text[2 * i + 1] = data[i] >> 8;
+  }
+  text[2 * count] = 0;
+}
+
+/*
+ * The field is checked against the block before its registers are addressed. The members are written by memcpy,
+ * so the structure needs no particular alignment of its members.
+ */
+bool EgoSmartHeaterDecoder::decodeBlock(const uint16_t *data, uint8_t count, const DecodeField_t *fields, uint8_t fieldCount, void *result)
+{
+  uint8_t *base = (uint8_t *)result;
+
+  for (uint8_t i = 0; i < fieldCount; i++)
+  {
+    const DecodeField_t &field = fields[i];
+
+    if (field.Type >= sizeof(TypeRegisters) || field.Register + TypeRegisters[field.Type] > count)
+      return false;
+
+    const uint16_t *value = data + field.Register;
+    uint8_t *member = base + field.Offset;
+
+    switch (field.Type)
+    {
+      case EGO_SH_DECODE_UINT16:
+      case EGO_SH_DECODE_INT16:
+        memcpy(member, value, sizeof(uint16_t));
+        break;
+      case EGO_SH_DECODE_UINT32:
+      case EGO_SH_DECODE_INT32:
+      {
+        uint32_t v = toUint32(value[0], value[1]);
+        memcpy(member, &v, sizeof(v));
+        break;
+      }
+      case EGO_SH_DECODE_FLOAT:
+      {
+        float v = toFloat(value[0], value[1]);
+        memcpy(member, &v, sizeof(v));
+        break;
+      }
+      case EGO_SH_DECODE_STRING32:
+        toChars(value, 16, (char *)member);
+        break;
+    }
+  }
+  return true;
+}
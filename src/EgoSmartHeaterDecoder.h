@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Decoding of modbus register values of E.G.O. RS485 Smart Heaters.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_DECODER_h
+#define EGO_SH_DECODER_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <string.h>
+//------------------------------------------------------------------------------
+#define EGO_SH_DECODE_UINT16 0      // 1 register, uint16_t
+#define EGO_SH_DECODE_INT16 1       // 1 register, int16_t
+#define EGO_SH_DECODE_UINT32 2      // 2 registers high word first, uint32_t
+#define EGO_SH_DECODE_INT32 3       // 2 registers high word first, int32_t
+#define EGO_SH_DECODE_FLOAT 4       // 2 registers high word first, float
+#define EGO_SH_DECODE_STRING32 5    // 16 registers, first character in the low byte, char[33]
+
+//------------------------------------------------------------------------------
+
+/// \struct DecodeField_t
+/// position of a value within a block of registers and within the structure receiving it
+struct DecodeField_t
+{
+  uint8_t Register;   // offset of the first register within the block
+  uint8_t Type;       // EGO_SH_DECODE_...
+  uint8_t Offset;     // offset of the member within the structure (offsetof)
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterDecoder
+/// Converts register values into typed values. The register values are combined arithmetically, independent of the
+/// byte order and alignment of the host, so no type punning by unions or pointer casts is needed. The integer
+/// conversions are constexpr and can be evaluated at compile time.
+/// decodeBlock converts a whole block of registers into a structure in one pass, driven by a table of DecodeField_t.
+/// It selects the conversion of each field by its type.
+class EgoSmartHeaterDecoder
+{
+public:
+  /// @brief Combine two registers, high word first.
+  /// @param high is the first register.
+  /// @param low is the second register.
+  /// @return 32 bit value.
+  static constexpr uint32_t toUint32(uint16_t high, uint16_t low)
+  {
+    return ((uint32_t)high << 16) | low;
+  }
+  /// @brief Combine two registers to a signed value, high word first.
+  static constexpr int32_t toInt32(uint16_t high, uint16_t low)
+  {
+    return (int32_t)toUint32(high, low);
+  }
+  /// @brief Convert a BCD encoded value into binary (e.g. 0x2014 to 2014).
+  /// @param bcd is the BCD value.
+  /// @return Binary value.
+  static constexpr uint32_t fromBcd(uint32_t bcd)
+  {
+    return (bcd == 0) ? 0 : fromBcd(bcd >> 4) * 10 + (bcd & 0x0F);
+  }
+  /// @return Year of a BCD encoded date like ProductionDate (0x20140515 = 2014).
+  static constexpr uint16_t getBcdYear(uint32_t date)
+  {
+    return fromBcd(date >> 16);
+  }
+  /// @return Month of a BCD encoded date (1 - 12).
+  static constexpr uint8_t getBcdMonth(uint32_t date)
+  {
+    return fromBcd((date >> 8) & 0xFF);
+  }
+  /// @return Day of a BCD encoded date (1 - 31).
+  static constexpr uint8_t getBcdDay(uint32_t date)
+  {
+    return fromBcd(date & 0xFF);
+  }
+  /// @brief Combine two registers to an IEEE 754 float, high word first.
+  static float toFloat(uint16_t high, uint16_t low)
+  {
+    uint32_t value = toUint32(high, low);
+    float result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+  }
+  /// @brief Convert registers into a zero terminated string, first character in the low byte of a register.
+  /// @param data are the registers.
+  /// @param count is the number of registers.
+  /// @param text receives 2 * count characters and the terminating zero.
+  static void toChars(const uint16_t *data, uint8_t count, char *text);
+
+  /// @brief Decode a block of registers into a structure.
+  /// @param data are the registers of the block.
+  /// @param count is the number of registers.
+  /// @param fields describes the values to be decoded.
+  /// @param fieldCount is the number of fields.
+  /// @param result is the structure receiving the values.
+  /// @return false if a field exceeds the block, the remaining fields are not decoded.
+  static bool decodeBlock(const uint16_t *data, uint8_t count, const DecodeField_t *fields, uint8_t fieldCount, void *result);
+};
+
+#endif //EGO_SH_DECODER_h
@@ -0,0 +1,209 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Bus scan for E.G.O. RS485 Smart Heaters, to find the modbus addresses of all connected devices.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterDiscovery.h"
+#if EGO_SH_FEATURE_IDENTITY
+#include <Arduino.h>
+
+static const uint16_t RegisterIdentity = 0x2000;    // ManufacturerId .. ProductionDate
+static const uint16_t IdentityLength = 0x36;
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterDiscovery::EgoSmartHeaterDiscovery(int dere_pin)
+{
+  _derePin = dere_pin;
+}
+
+void EgoSmartHeaterDiscovery::begin(Stream &serial, uint8_t first, uint8_t last)
+{
+  _serial = &serial;
+  _next = (first == 0) ? 1 : first;
+  _last = last;
+  _defaultProbed = (_next > EGO_SH_RS485_MODBUS_ADR || last < EGO_SH_RS485_MODBUS_ADR);
+  _deviceCount = 0;
+  _maxLatency = 0;
+  _timeout = EGO_SH_DISCOVERY_INITIAL_TIMEOUT;
+
+  if (_derePin >= 0)
+  {
+    pinMode(_derePin, OUTPUT);
+    digitalWrite(_derePin, 0);
+  }
+}
+
+/*
+ * Heaters are delivered with EGO_SH_RS485_MODBUS_ADR, so this address is probed first and skipped by the sweep. A
+ * device found there calibrates the timeout before the remaining addresses are probed.
+ */
+bool EgoSmartHeaterDiscovery::step()
+{
+  uint8_t slave;
+
+  if (_serial == NULL || _next == 0 || _next > _last)
+  {
+    _next = 0;
+    return false;
+  }
+
+  if (!_defaultProbed)
+  {
+    slave = EGO_SH_RS485_MODBUS_ADR;
+    _defaultProbed = true;
+  }
+  else
+  {
+    slave = _next;
+    _next = (_next < _last) ? _next + 1 : 0;
+  }
+  if (_next == EGO_SH_RS485_MODBUS_ADR)
+    _next = (_next < _last) ? _next + 1 : 0;
+
+  if (readRegisters(slave, RegisterIdentity, 1, _timeout) == ModbusMaster::ku8MBSuccess && _data[0] == EGO_SH_MANUFACTURER_ID)
+    readIdentity(slave);
+  return _next != 0;
+}
+
+uint8_t EgoSmartHeaterDiscovery::scan()
+{
+  while (step())
+  {
+    yield();
+  }
+  return _deviceCount;
+}
+
+uint8_t EgoSmartHeaterDiscovery::getNextAddress()
+{
+  return _next;
+}
+
+uint16_t EgoSmartHeaterDiscovery::getTimeout()
+{
+  return _timeout;
+}
+
+uint8_t EgoSmartHeaterDiscovery::getDeviceCount()
+{
+  return _deviceCount;
+}
+
+const DiscoveredDevice_t &EgoSmartHeaterDiscovery::getDevice(uint8_t i)
+{
+  return _devices[(i < _deviceCount) ? i : 0];
+}
+
+/*
+ * Reads the complete identity block by a single request. The probe already proved the device exists, so the regular
+ * maximum timeout is used here.
+ */
+void EgoSmartHeaterDiscovery::readIdentity(uint8_t slave)
+{
+  if (_deviceCount >= EGO_SH_DISCOVERY_MAX_DEVICES)
+    return;
+
+  DiscoveredDevice_t &device = _devices[_deviceCount++];
+  memset(&device, 0, sizeof(device));
+  device.SlaveId = slave;
+
+  if (readRegisters(slave, RegisterIdentity, IdentityLength, EGO_SH_DISCOVERY_MAX_TIMEOUT) != ModbusMaster::ku8MBSuccess)
+    return;
+  device.ProductId = _data[0x01];
+  device.ProductVersion = _data[0x02];
+  device.FirmwareVersion = _data[0x03];
+  EgoSmartHeaterDecoder::toChars(&_data[0x04], 16, device.VendorName);
+  EgoSmartHeaterDecoder::toChars(&_data[0x14], 16, device.ProductName);
+  EgoSmartHeaterDecoder::toChars(&_data[0x24], 16, device.SerialNumber);
+  device.ProductionDate = EgoSmartHeaterDecoder::toUint32(_data[0x34], _data[0x35]);
+}
+
+/*
+ * Single Read Holding Registers transaction. The timeout applies to the first byte of the response only, once a device
+ * answers the frame is received completely. The response latency of successful probes adapts the timeout: twice the
+ * slowest device seen so far, within EGO_SH_DISCOVERY_MIN_TIMEOUT and EGO_SH_DISCOVERY_MAX_TIMEOUT.
+ */
+uint8_t EgoSmartHeaterDiscovery::readRegisters(uint8_t slave, uint16_t reg, uint16_t qty, uint16_t timeout)
+{
+  uint8_t frame[EGO_SH_MODBUS_MAX_FRAME];
+  size_t len = EgoSmartHeaterModbusRtu::buildReadRequest(frame, slave, reg, qty);
+  size_t expected = 0;
+
+  // drop anything left from a previous response
+  while (_serial->read() >= 0)
+    ;
+
+  if (_derePin >= 0)
+    digitalWrite(_derePin, 1);
+  _serial->write(frame, len);
+  _serial->flush();
+  if (_derePin >= 0)
+    digitalWrite(_derePin, 0);
+
+  unsigned long start = millis();
+  unsigned long lastByte = start;
+  len = 0;
+  while (expected == 0 || len < expected)
+  {
+    if (_serial->available() > 0)
+    {
+      int c = _serial->read();
+      if (c < 0)
+        continue;
+      if (len == 0)
+      {
+        uint16_t latency = millis() - start;
+        if (latency > _maxLatency)
+          _maxLatency = latency;
+      }
+      lastByte = millis();
+      frame[len++] = c;
+      if (len >= sizeof(frame))
+        return ModbusMaster::ku8MBInvalidCRC;
+      expected = EgoSmartHeaterModbusRtu::getResponseLength(frame, len);
+    }
+    else if (len == 0 && millis() - start > timeout)
+    {
+      return ModbusMaster::ku8MBResponseTimedOut;
+    }
+    else if (len > 0 && millis() - lastByte > EGO_SH_DISCOVERY_BYTE_TIMEOUT)
+    {
+      return ModbusMaster::ku8MBResponseTimedOut;
+    }
+    else
+    {
+      yield();
+    }
+  }
+
+  if (!EgoSmartHeaterModbusRtu::checkCrc(frame, len))
+    return ModbusMaster::ku8MBInvalidCRC;
+  if (frame[0] != slave)
+    return ModbusMaster::ku8MBInvalidSlaveID;
+  if (frame[1] & 0x80)
+    return frame[2];
+  if (frame[1] != EGO_SH_MODBUS_FC_READ_HOLDING || frame[2] != qty * 2)
+    return ModbusMaster::ku8MBInvalidFunction;
+
+  for (uint16_t i = 0; i < qty; i++)
+  {
+    _data[i] = (frame[3 + 2 * i] << 8) | frame[4 + 2 * i];
+  }
+
+  _timeout = constrain(2 * _maxLatency, EGO_SH_DISCOVERY_MIN_TIMEOUT, EGO_SH_DISCOVERY_MAX_TIMEOUT);
+  return ModbusMaster::ku8MBSuccess;
+}
+
+#endif //EGO_SH_FEATURE_IDENTITY
@@ -0,0 +1,107 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Bus scan for E.G.O. RS485 Smart Heaters, to find the modbus addresses of all connected devices.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_DISCOVERY_h
+#define EGO_SH_DISCOVERY_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#include "EgoSmartHeaterModbusRtu.h"
+#include "EgoSmartHeaterDecoder.h"
+#if EGO_SH_FEATURE_IDENTITY
+//------------------------------------------------------------------------------
+#define EGO_SH_MANUFACTURER_ID 0x14EF           // ManufacturerId (0x2000) of all EGO devices
+#define EGO_SH_DISCOVERY_MAX_DEVICES 8          // Maximum number of devices recorded by a scan
+#define EGO_SH_DISCOVERY_MIN_TIMEOUT 15         // Lower limit of the adaptive response timeout in milliseconds
+#define EGO_SH_DISCOVERY_MAX_TIMEOUT 200        // Upper limit of the adaptive response timeout in milliseconds
+#define EGO_SH_DISCOVERY_INITIAL_TIMEOUT 50     // Response timeout until the first device answered
+#define EGO_SH_DISCOVERY_BYTE_TIMEOUT 10        // Maximum gap between two bytes of a response in milliseconds
+
+//------------------------------------------------------------------------------
+
+/// \struct DiscoveredDevice_t
+/// identity of a device found by the bus scan
+struct DiscoveredDevice_t
+{
+  uint8_t SlaveId;
+  uint16_t ProductId;
+  uint16_t ProductVersion;
+  uint16_t FirmwareVersion;
+  char VendorName[EGO_SH_RS485_STRING_LEN + 1];
+  char ProductName[EGO_SH_RS485_STRING_LEN + 1];
+  char SerialNumber[EGO_SH_RS485_STRING_LEN + 1];
+  uint32_t ProductionDate;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterDiscovery
+/// Scans a range of modbus addresses for Smart Heaters. Every address is probed by reading the ManufacturerId (0x2000)
+/// with a short timeout, which adapts to the response time of the devices found so far. The default address
+/// EGO_SH_RS485_MODBUS_ADR is probed first, since heaters are delivered with it. If a device answers with 0x14EF, its
+/// complete identity (0x2000 - 0x2035) is read by a single request.
+/// The scan can be run at once by scan() or incrementally by step(), e.g. one address per loop() iteration. The next
+/// address (getNextAddress) can be stored to resume an interrupted scan later. The resumed scan doesn't know the
+/// devices found before the interruption, store them together with the address.
+/// The scan talks to the bus directly, do not use an EgoSmartHeaterRS485 instance on the same bus at the same time.
+class EgoSmartHeaterDiscovery
+{
+public:
+  /// @brief Constructor to setup the scan in automatic or manual DE/RE control.
+  /// @param dere_pin is the number of the PIN which controls DE/RE of the MAX485 board (default: -1 = automatic).
+  EgoSmartHeaterDiscovery(int dere_pin = -1);
+
+  /// @brief Prepare a scan. Found devices of a previous scan are cleared, also if the scan resumes an interrupted one.
+  /// @param serial is the serial interface of the bus.
+  /// @param first is the first address to probe (default: 1).
+  /// @param last is the last address to probe (default: 247).
+  void begin(Stream &serial, uint8_t first = 1, uint8_t last = EGO_SH_RS485_MODBUS_ADR);
+  /// @brief Probe the next address.
+  /// @return true if there are addresses left to probe.
+  bool step();
+  /// @brief Probe all remaining addresses.
+  /// @return Number of devices found.
+  uint8_t scan();
+
+  /// @return Next address to be probed, 0 if the scan is finished.
+  uint8_t getNextAddress();
+  /// @return Current response timeout in milliseconds.
+  uint16_t getTimeout();
+  /// @return Number of devices found.
+  uint8_t getDeviceCount();
+  /// @brief Retrieve a found device.
+  /// @param i is the number of the device (0 .. getDeviceCount() - 1).
+  /// @return Identity of the device.
+  const DiscoveredDevice_t &getDevice(uint8_t i);
+
+protected:
+  Stream *_serial = NULL;
+  int _derePin;
+  uint8_t _next = 0;
+  uint8_t _last = 0;
+  bool _defaultProbed = false;
+  uint16_t _timeout = EGO_SH_DISCOVERY_INITIAL_TIMEOUT;
+  uint16_t _maxLatency = 0;
+  uint8_t _deviceCount = 0;
+  DiscoveredDevice_t _devices[EGO_SH_DISCOVERY_MAX_DEVICES];
+  uint16_t _data[EGO_SH_MODBUS_MAX_READ];
+
+  uint8_t readRegisters(uint8_t slave, uint16_t reg, uint16_t qty, uint16_t timeout);
+  void readIdentity(uint8_t slave);
+};
+
+#endif //EGO_SH_FEATURE_IDENTITY
+#endif //EGO_SH_DISCOVERY_h
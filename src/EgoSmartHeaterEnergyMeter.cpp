@@ -0,0 +1,141 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Energy accounting for E.G.O. RS485 Smart Heaters, based on the operating time counters of the relais.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterEnergyMeter.h"
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterEnergyMeter::EgoSmartHeaterEnergyMeter()
+{
+  for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+  {
+    _power[r] = 500 << r;
+    _lastSeconds[r] = 0;
+  }
+}
+
+void EgoSmartHeaterEnergyMeter::setRelaisPower(const RelaisConfigurationSet_t &relais)
+{
+  for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+  {
+    if (relais.Valid[r] && relais.Relais[r].ActualPower > 0)
+      _power[r] = relais.Relais[r].ActualPower;
+  }
+}
+
+void EgoSmartHeaterEnergyMeter::setRelaisPower(int r, uint16_t power)
+{
+  if (r >= 0 && r < EGO_SH_RS485_RELAIS_COUNT)
+    _power[r] = power;
+}
+
+/*
+ * The counters run on the clock of the heater, so an increase may exceed the local elapsed time by a small drift and
+ * the second a counter was just incremented when sampled (EGO_SH_ENERGY_MARGIN). A rejected sample keeps the base,
+ * so the energy of that interval is counted by the next plausible sample. Only after EGO_SH_ENERGY_MAX_REJECTS
+ * implausible samples in a row the last one becomes the new base, so a counter changed on the device can't block the
+ * accounting. After a restart the sample always becomes the base.
+ * The getters return 0 if a read fails. RestartCounter is at least 1, and all counters dropping to 0 without a restart
+ * is not possible either: such a sample is rejected and never becomes the base.
+ */
+bool EgoSmartHeaterEnergyMeter::update(uint32_t now, uint32_t restartCounter, const RelaisOperatingTime_t &time)
+{
+  uint32_t seconds[EGO_SH_RS485_RELAIS_COUNT] = {time.OperatingSeconds1, time.OperatingSeconds2, time.OperatingSeconds3};
+  uint32_t delta[EGO_SH_RS485_RELAIS_COUNT];
+  uint32_t elapsed = (now - _lastTime) / 1000;
+  uint32_t limit = elapsed + elapsed / 16 + EGO_SH_ENERGY_MARGIN;
+  bool restarted = _valid && restartCounter != _lastRestartCounter;
+  bool plausible = _valid;
+  bool zero = true;
+  bool counted = false;
+
+  for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+  {
+    if (seconds[r] != 0)
+      zero = false;
+    if (_lastSeconds[r] != 0)
+      counted = true;
+  }
+  if (restartCounter == 0 || (_valid && !restarted && zero && counted))
+  {
+    _rejected++;
+    return false;
+  }
+
+  for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+  {
+    delta[r] = seconds[r] - _lastSeconds[r];
+    if (delta[r] > limit)
+    {
+      // a counter reset by the restart counts from 0
+      if (restarted && seconds[r] <= limit)
+        delta[r] = seconds[r];
+      else
+        plausible = false;
+    }
+  }
+  if (_valid && !plausible)
+  {
+    _rejected++;
+    if (!restarted && ++_rejectedInRow < EGO_SH_ENERGY_MAX_REJECTS)
+      return false;
+  }
+
+  _valid = true;
+  _rejectedInRow = 0;
+  _lastTime = now;
+  _lastRestartCounter = restartCounter;
+  memcpy(_lastSeconds, seconds, sizeof(_lastSeconds));
+  if (!plausible)
+    return false;
+
+  for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+  {
+    _energy += (uint64_t)delta[r] * _power[r];
+  }
+  return true;
+}
+
+void EgoSmartHeaterEnergyMeter::reset()
+{
+  _valid = false;
+}
+
+uint64_t EgoSmartHeaterEnergyMeter::getEnergyWs()
+{
+  return _energy;
+}
+
+uint32_t EgoSmartHeaterEnergyMeter::getEnergyWh()
+{
+  return _energy / 3600;
+}
+
+float EgoSmartHeaterEnergyMeter::getEnergyKWh()
+{
+  return _energy / 3600000.0f;
+}
+
+void EgoSmartHeaterEnergyMeter::setEnergyWs(uint64_t energy)
+{
+  _energy = energy;
+}
+
+uint32_t EgoSmartHeaterEnergyMeter::getRejectedCount()
+{
+  return _rejected;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Energy accounting for E.G.O. RS485 Smart Heaters, based on the operating time counters of the relais.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_ENERGY_METER_h
+#define EGO_SH_ENERGY_METER_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+//------------------------------------------------------------------------------
+#define EGO_SH_ENERGY_MARGIN 2      // Seconds the counters may run ahead of the local clock between two samples
+#define EGO_SH_ENERGY_MAX_REJECTS 3 // Implausible samples in a row after which the last one becomes the new base
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterEnergyMeter
+/// Sums up the energy delivered by a Smart Heater. The heater counts the operating seconds of every relais
+/// (0x1409 - 0x140E), so the energy between two samples is the increase of each counter multiplied by the ActualPower
+/// of the relais. Short switching periods between two samples are included, the samples may be taken at any interval.
+/// Counter increases are calculated modulo 2^32, so a wrap of a counter is handled. An increase larger than the time
+/// elapsed since the last sample is not plausible: after a restart of the heater (RestartCounter, 0x1202 changed) a
+/// counter which was reset counts from 0, otherwise the sample is rejected and the base is kept, so the energy of the
+/// interval is counted by the next plausible sample.
+/// The state is a few counters, independent of the time the meter runs. The total can be stored and restored by
+/// setEnergyWs to continue after a reboot of the controller.
+class EgoSmartHeaterEnergyMeter
+{
+public:
+  /// @brief Constructor to setup the meter with the nominal power of the relais (500W, 1000W, 2000W).
+  EgoSmartHeaterEnergyMeter();
+
+  /// @brief Configure the power of the relais from their configuration (see getRelaisConfigurations).
+  /// Relais without a valid configuration keep their power.
+  /// @param relais is the configuration of all relais.
+  void setRelaisPower(const RelaisConfigurationSet_t &relais);
+  /// @brief Configure the power of a single relais.
+  /// @param r is the number of the relais (0: 500W, 1: 1000W, 2: 2000W).
+  /// @param power is the power in Watts.
+  void setRelaisPower(int r, uint16_t power);
+
+  /// @brief Pass a sample of the counters. Check getErrCode() after reading them and pass successful reads only, since
+  /// the getters return 0 if a read fails. Samples which look like a failed read are rejected without becoming the base.
+  /// @param now is the time of the sample in milliseconds (e.g. millis()).
+  /// @param restartCounter is the result of getRestartCounter().
+  /// @param time is the result of getRelaisOperatingTime().
+  /// @return true if the sample was added, false for the first sample and rejected samples.
+  bool update(uint32_t now, uint32_t restartCounter, const RelaisOperatingTime_t &time);
+  /// @brief Forget the last sample, the next sample is used as new base. The total is kept.
+  void reset();
+
+  /// @return Total energy in Watt seconds.
+  uint64_t getEnergyWs();
+  /// @return Total energy in Watt hours.
+  uint32_t getEnergyWh();
+  /// @return Total energy in kWh.
+  float getEnergyKWh();
+  /// @brief Restore a stored total.
+  /// @param energy is the total energy in Watt seconds.
+  void setEnergyWs(uint64_t energy);
+  /// @return Number of rejected samples.
+  uint32_t getRejectedCount();
+
+protected:
+  uint16_t _power[EGO_SH_RS485_RELAIS_COUNT];
+  uint64_t _energy = 0;
+  uint32_t _rejected = 0;
+  uint8_t _rejectedInRow = 0;
+
+  bool _valid = false;
+  uint32_t _lastTime = 0;
+  uint32_t _lastRestartCounter = 0;
+  uint32_t _lastSeconds[EGO_SH_RS485_RELAIS_COUNT];
+};
+
+#endif //EGO_SH_ENERGY_METER_h
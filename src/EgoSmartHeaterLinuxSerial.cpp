@@ -0,0 +1,302 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Native serial interface for running the library on Linux gateways.
+ * Provides a Stream on top of a termios device (e.g. /dev/ttyUSB0, /dev/ttyAMA0) or a pseudo terminal.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterLinuxSerial.h"
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <linux/serial.h>
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterLinuxSerial::EgoSmartHeaterLinuxSerial()
+{
+}
+
+EgoSmartHeaterLinuxSerial::~EgoSmartHeaterLinuxSerial()
+{
+  end();
+}
+
+bool EgoSmartHeaterLinuxSerial::begin(const char *device, unsigned long baud, int deGpio)
+{
+  int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+  if (fd < 0)
+    return false;
+  if (!begin(fd))
+    return false;
+  if (!configure(baud))
+  {
+    end();
+    return false;
+  }
+
+  // kernel controlled driver direction if supported by the UART driver, GPIO otherwise
+  struct serial_rs485 rs485;
+  memset(&rs485, 0, sizeof(rs485));
+  rs485.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND;
+  _kernelRs485 = (ioctl(_fd, TIOCSRS485, &rs485) == 0);
+  if (!_kernelRs485 && deGpio >= 0 && !openGpio(deGpio))
+  {
+    end();
+    return false;
+  }
+  if (!setDirection(false))
+  {
+    end();
+    return false;
+  }
+  return true;
+}
+
+bool EgoSmartHeaterLinuxSerial::begin(int fd)
+{
+  struct epoll_event event;
+
+  end();
+  if (fd < 0)
+    return false;
+  _fd = fd;
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+  _epoll = epoll_create1(EPOLL_CLOEXEC);
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = _fd;
+  if (_epoll < 0 || epoll_ctl(_epoll, EPOLL_CTL_ADD, _fd, &event) != 0)
+  {
+    end();
+    return false;
+  }
+  return true;
+}
+
+void EgoSmartHeaterLinuxSerial::end()
+{
+  if (_deFd >= 0)
+    close(_deFd);
+  if (_epoll >= 0)
+    close(_epoll);
+  if (_fd >= 0)
+    close(_fd);
+  _deFd = _epoll = _fd = -1;
+  _kernelRs485 = false;
+  _directionError = false;
+  _transmitting = false;
+  _rxHead = _rxTail = 0;
+}
+
+bool EgoSmartHeaterLinuxSerial::isKernelRs485()
+{
+  return _kernelRs485;
+}
+
+bool EgoSmartHeaterLinuxSerial::hasDirectionError()
+{
+  return _directionError;
+}
+
+/*
+ * Raw mode, 8 data bits, even parity, 1 stop bit (8E1), no flow control
+ */
+bool EgoSmartHeaterLinuxSerial::configure(unsigned long baud)
+{
+  struct termios tio;
+  speed_t speed;
+
+  switch (baud)
+  {
+    case 9600: speed = B9600; break;
+    case 19200: speed = B19200; break;
+    case 38400: speed = B38400; break;
+    case 57600: speed = B57600; break;
+    case 115200: speed = B115200; break;
+    default: return false;
+  }
+
+  if (tcgetattr(_fd, &tio) != 0)
+    return false;
+  cfmakeraw(&tio);
+  tio.c_cflag &= ~(CSIZE | PARODD | CSTOPB | CRTSCTS);
+  tio.c_cflag |= CS8 | PARENB | CLOCAL | CREAD;
+  tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(_fd, TCSANOW, &tio) != 0)
+    return false;
+  tcflush(_fd, TCIOFLUSH);
+  return true;
+}
+
+/*
+ * Exports the GPIO via sysfs and keeps the value file open, so switching the direction costs a single write.
+ */
+bool EgoSmartHeaterLinuxSerial::openGpio(int gpio)
+{
+  char path[64];
+  char number[16];
+  int fd;
+
+  snprintf(number, sizeof(number), "%d", gpio);
+  fd = open("/sys/class/gpio/export", O_WRONLY | O_CLOEXEC);
+  if (fd >= 0)
+  {
+    // fails with EBUSY if already exported, which is fine
+    if (::write(fd, number, strlen(number)) < 0 && errno != EBUSY)
+    {
+      close(fd);
+      return false;
+    }
+    close(fd);
+  }
+
+  snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/direction", gpio);
+  fd = open(path, O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  bool ok = ::write(fd, "out", 3) == 3;
+  close(fd);
+  if (!ok)
+    return false;
+
+  snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", gpio);
+  _deFd = open(path, O_WRONLY | O_CLOEXEC);
+  return _deFd >= 0;
+}
+
+/*
+ * A failed GPIO write is recorded in _directionError and stays set until the device is opened again.
+ */
+bool EgoSmartHeaterLinuxSerial::setDirection(bool transmit)
+{
+  _transmitting = transmit;
+  if (_deFd >= 0 && ::write(_deFd, transmit ? "1" : "0", 1) != 1)
+  {
+    _directionError = true;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Moves pending bytes from the device into the receive buffer, waiting up to timeout milliseconds if there are none.
+ */
+size_t EgoSmartHeaterLinuxSerial::fill(int timeout)
+{
+  struct epoll_event event;
+
+  if (_fd < 0)
+    return 0;
+  if (_rxHead == _rxTail)
+    _rxHead = _rxTail = 0;
+
+  for (int attempt = 0; attempt < 2 && _rxTail < sizeof(_rx); attempt++)
+  {
+    ssize_t n = ::read(_fd, _rx + _rxTail, sizeof(_rx) - _rxTail);
+    if (n > 0)
+    {
+      _rxTail += n;
+      break;
+    }
+    if (attempt == 0 && timeout > 0 && _rxHead == _rxTail)
+      epoll_wait(_epoll, &event, 1, timeout);
+    else
+      break;
+  }
+  return _rxTail - _rxHead;
+}
+
+int EgoSmartHeaterLinuxSerial::available()
+{
+  if (_rxHead < _rxTail)
+    return _rxTail - _rxHead;
+  return fill(EGO_SH_LINUX_POLL_TIMEOUT);
+}
+
+int EgoSmartHeaterLinuxSerial::read()
+{
+  if (_rxHead == _rxTail && fill(0) == 0)
+    return -1;
+  return _rx[_rxHead++];
+}
+
+int EgoSmartHeaterLinuxSerial::peek()
+{
+  if (_rxHead == _rxTail && fill(0) == 0)
+    return -1;
+  return _rx[_rxHead];
+}
+
+size_t EgoSmartHeaterLinuxSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+/*
+ * The driver is enabled with the first byte of a frame and disabled by flush(), which ModbusMaster calls after each frame.
+ * Nothing is sent if the driver can't be enabled, the request then times out.
+ */
+size_t EgoSmartHeaterLinuxSerial::write(const uint8_t *buffer, size_t size)
+{
+  size_t written = 0;
+
+  if (_fd < 0)
+    return 0;
+  if (!_transmitting && !setDirection(true))
+    return 0;
+
+  while (written < size)
+  {
+    ssize_t n = ::write(_fd, buffer + written, size - written);
+    if (n > 0)
+    {
+      written += n;
+    }
+    else if (n < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+      // transmit queue full, wait until it accepts more data
+      struct pollfd pfd = {_fd, POLLOUT, 0};
+      poll(&pfd, 1, 10);
+    }
+    else
+    {
+      break;
+    }
+  }
+  return written;
+}
+
+void EgoSmartHeaterLinuxSerial::flush()
+{
+  if (_fd < 0)
+    return;
+  tcdrain(_fd);
+  if (_transmitting)
+    setDirection(false);
+}
+
+#endif //__linux__
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Native serial interface for running the library on Linux gateways.
+ * Provides a Stream on top of a termios device (e.g. /dev/ttyUSB0, /dev/ttyAMA0) or a pseudo terminal.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_LINUX_SERIAL_h
+#define EGO_SH_LINUX_SERIAL_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#if defined(__linux__)
+//------------------------------------------------------------------------------
+#define EGO_SH_LINUX_RX_BUFFER 256      // Size of the receive buffer in bytes
+#define EGO_SH_LINUX_POLL_TIMEOUT 1     // Time in milliseconds available() waits for data if none is buffered
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterLinuxSerial
+/// Serial interface for Linux, to be passed to EgoSmartHeaterRS485::begin().
+/// The device is configured to 8E1 at the given baud rate. The RS485 driver direction is controlled by the kernel
+/// (TIOCSRS485) if the UART driver supports it, otherwise by a sysfs GPIO if one is configured. USB-RS485 adapters
+/// usually control the direction themselves and need neither.
+/// Reads are non-blocking, available() waits up to EGO_SH_LINUX_POLL_TIMEOUT on an epoll instance so that the
+/// receive loop of ModbusMaster doesn't spin at full CPU load.
+class EgoSmartHeaterLinuxSerial : public Stream
+{
+public:
+  EgoSmartHeaterLinuxSerial();
+  ~EgoSmartHeaterLinuxSerial();
+
+  /// @brief Open and configure a serial device.
+  /// @param device is the path of the device, e.g. /dev/ttyUSB0.
+  /// @param baud is the baud rate (default: EGO_SH_RS485_SERIAL_BAUD).
+  /// @param deGpio is the sysfs GPIO number driving DE/RE, used if the kernel doesn't support RS485 mode (default: -1 = none).
+  /// @return true if the device has been opened.
+  bool begin(const char *device, unsigned long baud = EGO_SH_RS485_SERIAL_BAUD, int deGpio = -1);
+  /// @brief Use an already opened file descriptor, e.g. the master side of a pseudo terminal. Its settings are not changed.
+  /// @param fd is the file descriptor, which is closed by end().
+  /// @return true if the descriptor could be registered.
+  bool begin(int fd);
+  /// @brief Close the device.
+  void end();
+  /// @return true if the kernel controls the RS485 driver direction.
+  bool isKernelRs485();
+  /// @return true if setting the DE/RE GPIO failed since the device was opened. Frames are not sent while the driver
+  /// can't be enabled, so the requests time out.
+  bool hasDirectionError();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  void flush() override;
+  using Print::write;
+
+protected:
+  int _fd = -1;
+  int _epoll = -1;
+  int _deFd = -1;
+  bool _kernelRs485 = false;
+  bool _transmitting = false;
+  bool _directionError = false;
+  uint8_t _rx[EGO_SH_LINUX_RX_BUFFER];
+  size_t _rxHead = 0;
+  size_t _rxTail = 0;
+
+  bool configure(unsigned long baud);
+  bool openGpio(int gpio);
+  bool setDirection(bool transmit);
+  size_t fill(int timeout);
+};
+
+#endif //__linux__
+#endif //EGO_SH_LINUX_SERIAL_h
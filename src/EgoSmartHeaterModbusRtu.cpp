@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Modbus RTU framing helpers for E.G.O. RS485 Smart Heaters.
+ * Used by the components which talk to the bus without ModbusMaster.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterModbusRtu.h"
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+uint16_t EgoSmartHeaterModbusRtu::crc16(const uint8_t *data, size_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++)
+    {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+    }
+  }
+  return crc;
+}
+
+bool EgoSmartHeaterModbusRtu::checkCrc(const uint8_t *frame, size_t len)
+{
+  if (len < 4)
+    return false;
+  uint16_t crc = crc16(frame, len - 2);
+  return frame[len - 2] == (crc & 0xFF) && frame[len - 1] == (crc >> 8);
+}
+
+size_t EgoSmartHeaterModbusRtu::appendCrc(uint8_t *frame, size_t len)
+{
+  uint16_t crc = crc16(frame, len);
+  frame[len] = crc & 0xFF;
+  frame[len + 1] = crc >> 8;
+  return len + 2;
+}
+
+size_t EgoSmartHeaterModbusRtu::buildReadRequest(uint8_t *frame, uint8_t slave, uint16_t reg, uint16_t qty)
+{
+  frame[0] = slave;
+  frame[1] = EGO_SH_MODBUS_FC_READ_HOLDING;
+  frame[2] = reg >> 8;
+  frame[3] = reg & 0xFF;
+  frame[4] = qty >> 8;
+  frame[5] = qty & 0xFF;
+  return appendCrc(frame, 6);
+}
+
+size_t EgoSmartHeaterModbusRtu::buildWriteRequest(uint8_t *frame, uint8_t slave, uint16_t reg, const uint16_t *values, uint16_t qty)
+{
+  frame[0] = slave;
+  frame[1] = EGO_SH_MODBUS_FC_WRITE_MULTIPLE;
+  frame[2] = reg >> 8;
+  frame[3] = reg & 0xFF;
+  frame[4] = qty >> 8;
+  frame[5] = qty & 0xFF;
+  frame[6] = qty * 2;
+  for (uint16_t i = 0; i < qty; i++)
+  {
+    frame[7 + 2 * i] = values[i] >> 8;
+    frame[8 + 2 * i] = values[i] & 0xFF;
+  }
+  return appendCrc(frame, 7 + 2 * qty);
+}
+
+size_t EgoSmartHeaterModbusRtu::getResponseLength(const uint8_t *frame, size_t len)
+{
+  if (len < 3)
+    return 0;
+  // exception response: slave, function | 0x80, exception code, CRC
+  if (frame[1] & 0x80)
+    return 5;
+  switch (frame[1])
+  {
+    case EGO_SH_MODBUS_FC_READ_HOLDING:
+      return 5 + frame[2];
+    case EGO_SH_MODBUS_FC_WRITE_MULTIPLE:
+      return 8;
+  }
+  return 0;
+}
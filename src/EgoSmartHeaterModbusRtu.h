@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Modbus RTU framing helpers for E.G.O. RS485 Smart Heaters.
+ * Used by the components which talk to the bus without ModbusMaster.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_MODBUS_RTU_h
+#define EGO_SH_MODBUS_RTU_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+//------------------------------------------------------------------------------
+#define EGO_SH_MODBUS_FC_READ_HOLDING 0x03      // Function code Read Holding Registers
+#define EGO_SH_MODBUS_FC_WRITE_MULTIPLE 0x10    // Function code Write Multiple Registers
+#define EGO_SH_MODBUS_MAX_FRAME 256             // Maximum size of a modbus RTU frame in bytes
+#define EGO_SH_MODBUS_MAX_READ 125              // Maximum number of registers of a single read
+#define EGO_SH_MODBUS_MAX_WRITE 123             // Maximum number of registers of a single write
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterModbusRtu
+/// CRC calculation and framing of modbus RTU requests and responses
+class EgoSmartHeaterModbusRtu
+{
+public:
+  /// @brief Calculate the modbus CRC-16 (polynomial 0xA001, initial value 0xFFFF).
+  /// @param data is the buffer to be checked.
+  /// @param len is the number of bytes.
+  /// @return CRC, to be transmitted low byte first.
+  static uint16_t crc16(const uint8_t *data, size_t len);
+  /// @brief Check the CRC of a received frame.
+  /// @param frame is the complete frame including the two CRC bytes.
+  /// @param len is the length of the frame.
+  /// @return true if the CRC matches.
+  static bool checkCrc(const uint8_t *frame, size_t len);
+  /// @brief Append the CRC to a frame.
+  /// @param frame is the frame, the buffer must provide two additional bytes.
+  /// @param len is the length of the frame without CRC.
+  /// @return length of the frame including the CRC.
+  static size_t appendCrc(uint8_t *frame, size_t len);
+  /// @brief Build a Read Holding Registers request.
+  /// @param frame is the buffer receiving the request (8 bytes).
+  /// @param slave is the modbus address of the device.
+  /// @param reg is the first register.
+  /// @param qty is the number of registers.
+  /// @return length of the request including the CRC.
+  static size_t buildReadRequest(uint8_t *frame, uint8_t slave, uint16_t reg, uint16_t qty);
+  /// @brief Build a Write Multiple Registers request.
+  /// @param frame is the buffer receiving the request (9 + 2 * qty bytes).
+  /// @param slave is the modbus address of the device.
+  /// @param reg is the first register.
+  /// @param values are the register values.
+  /// @param qty is the number of registers (max. EGO_SH_MODBUS_MAX_WRITE).
+  /// @return length of the request including the CRC.
+  static size_t buildWriteRequest(uint8_t *frame, uint8_t slave, uint16_t reg, const uint16_t *values, uint16_t qty);
+  /// @brief Expected length of a response, based on the bytes received so far.
+  /// @param frame is the received part of the response.
+  /// @param len is the number of bytes received.
+  /// @return length of the complete response, 0 if not known yet.
+  static size_t getResponseLength(const uint8_t *frame, size_t len);
+};
+
+#endif //EGO_SH_MODBUS_RTU_h
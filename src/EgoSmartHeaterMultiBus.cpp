@@ -0,0 +1,334 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Concurrent polling of E.G.O. RS485 Smart Heaters connected to several RS485 buses.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterMultiBus.h"
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterMultiBus::EgoSmartHeaterMultiBus()
+{
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  _running = false;
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  _mutex = xSemaphoreCreateMutex();
+#endif
+}
+
+EgoSmartHeaterMultiBus::~EgoSmartHeaterMultiBus()
+{
+  stop();
+#if defined(EGO_SH_MULTIBUS_TASKS)
+  vSemaphoreDelete(_mutex);
+#endif
+}
+
+void EgoSmartHeaterMultiBus::lock()
+{
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  _mutex.lock();
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+#endif
+}
+
+void EgoSmartHeaterMultiBus::unlock()
+{
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  _mutex.unlock();
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  xSemaphoreGive(_mutex);
+#endif
+}
+
+int EgoSmartHeaterMultiBus::addBus(Stream &serial)
+{
+  if (_busCount >= EGO_SH_MULTIBUS_MAX_BUSES || _running)
+    return -1;
+  _serial[_busCount] = &serial;
+  _pollInterval[_busCount] = EGO_SH_MULTIBUS_POLL_INTERVAL;
+  _nextRound[_busCount] = millis();
+  _newValue[_busCount] = false;
+  return _busCount++;
+}
+
+bool EgoSmartHeaterMultiBus::setPollInterval(uint8_t bus, uint32_t interval)
+{
+  if (bus >= _busCount)
+    return false;
+  lock();
+  _pollInterval[bus] = interval;
+  unlock();
+  return true;
+}
+
+int EgoSmartHeaterMultiBus::addHeater(uint8_t bus, uint8_t slave)
+{
+  if (bus >= _busCount || _heaterCount >= EGO_SH_MULTIBUS_MAX_HEATERS || _running)
+    return -1;
+
+  Device_t &device = _device[_heaterCount];
+  memset(&device, 0, sizeof(device));
+  device.Snapshot.Bus = bus;
+  device.Snapshot.SlaveId = slave;
+  device.Snapshot.PowerNominalValue = -99;
+  device.Snapshot.ErrCode = ModbusMaster::ku8MBResponseTimedOut;
+  return _heaterCount++;
+}
+
+bool EgoSmartHeaterMultiBus::start()
+{
+  if (_running)
+    return true;
+
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  _running = true;
+  for (uint8_t b = 0; b < _busCount; b++)
+  {
+    _worker[b] = std::thread(&EgoSmartHeaterMultiBus::runBus, this, b);
+  }
+  return true;
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  _running = true;
+  for (uint8_t b = 0; b < _busCount; b++)
+  {
+    _worker[b].Self = this;
+    _worker[b].Bus = b;
+    _activeWorkers++;
+    xTaskCreate(runTask, "EgoSmartHeaterBus", 4096, &_worker[b], 1, NULL);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void EgoSmartHeaterMultiBus::stop()
+{
+  if (!_running)
+    return;
+
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  // set under the lock, so a worker can't miss the notification between checking and waiting
+  lock();
+  _running = false;
+  unlock();
+  _wake.notify_all();
+  for (uint8_t b = 0; b < _busCount; b++)
+  {
+    if (_worker[b].joinable())
+      _worker[b].join();
+  }
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  _running = false;
+  while (_activeWorkers > 0)
+    vTaskDelay(1);
+#else
+  _running = false;
+#endif
+}
+
+#if defined(EGO_SH_MULTIBUS_TASKS)
+/*
+ * FreeRTOS task entry, the parameter points to the Worker_t of the bus.
+ */
+void EgoSmartHeaterMultiBus::runTask(void *parameter)
+{
+  Worker_t *worker = (Worker_t *)parameter;
+  EgoSmartHeaterMultiBus *self = worker->Self;
+
+  self->runBus(worker->Bus);
+
+  self->lock();
+  self->_activeWorkers--;
+  self->unlock();
+  vTaskDelete(NULL);
+}
+#endif
+
+void EgoSmartHeaterMultiBus::runBus(uint8_t bus)
+{
+  while (_running)
+  {
+    uint32_t start = millis();
+    pollBus(bus);
+    waitForRound(bus, start);
+  }
+}
+
+/*
+ * On Linux the worker waits on the condition variable, so stop() and a new power value end the wait at once.
+ * The ESP32 task sleeps for the rest of the interval, at least one tick to let the other tasks run.
+ */
+void EgoSmartHeaterMultiBus::waitForRound(uint8_t bus, uint32_t start)
+{
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  std::unique_lock<std::mutex> guard(_mutex);
+  uint32_t elapsed = millis() - start;
+  if (elapsed < _pollInterval[bus])
+  {
+    _wake.wait_for(guard, std::chrono::milliseconds(_pollInterval[bus] - elapsed),
+                   [this, bus] { return !_running || _newValue[bus]; });
+  }
+  _newValue[bus] = false;
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  lock();
+  uint32_t interval = _pollInterval[bus];
+  unlock();
+  uint32_t elapsed = millis() - start;
+  TickType_t ticks = (elapsed < interval) ? pdMS_TO_TICKS(interval - elapsed) : 0;
+  vTaskDelay(ticks > 0 ? ticks : 1);
+#endif
+}
+
+void EgoSmartHeaterMultiBus::poll()
+{
+  for (uint8_t b = 0; b < _busCount; b++)
+  {
+    uint32_t now = millis();
+    if ((int32_t)(now - _nextRound[b]) >= 0 || _newValue[b])
+    {
+      _nextRound[b] = now + _pollInterval[b];
+      _newValue[b] = false;
+      pollBus(b);
+    }
+  }
+}
+
+void EgoSmartHeaterMultiBus::pollBus(uint8_t bus)
+{
+  for (uint8_t h = 0; h < _heaterCount; h++)
+  {
+    if (_device[h].Snapshot.Bus == bus)
+      pollHeater(bus, h);
+  }
+}
+
+/*
+ * Only the worker of the bus accesses the EgoSmartHeaterRS485 instance of the bus, the registry is protected by the mutex.
+ * The bus transactions are performed without holding the lock, so the buses don't block each other.
+ */
+void EgoSmartHeaterMultiBus::pollHeater(uint8_t bus, uint8_t heater)
+{
+  EgoSmartHeaterRS485 &node = _heater[bus];
+  Device_t &device = _device[heater];
+  bool write = false;
+  int16_t power = 0;
+
+  lock();
+  uint8_t slave = device.Snapshot.SlaveId;
+  if (device.Pending || (device.Snapshot.PowerNominalValue != -99 && millis() - device.LastActivation >= EGO_SH_MULTIBUS_KEEPALIVE))
+  {
+    write = true;
+    power = device.PowerNominalValue;
+    device.Pending = false;
+  }
+  unlock();
+
+  node.begin(*_serial[bus], slave);
+  node.clearErrCode();
+  if (write)
+    node.setPowerNominalValue(power);
+  uint8_t writeResult = node.getErrCode(true);
+  int16_t temperature = node.getActualTemperatureBoiler();
+  uint8_t result = node.getErrCode();
+  uint16_t relaisStatus = node.getRelaisStatus();
+  if (result == ModbusMaster::ku8MBSuccess)
+    result = node.getErrCode();
+
+  lock();
+  if (write)
+  {
+    if (writeResult == ModbusMaster::ku8MBSuccess)
+    {
+      device.Snapshot.PowerNominalValue = power;
+      device.LastActivation = millis();
+    }
+    else if (!device.Pending)
+    {
+      // retry with the next poll
+      device.Pending = true;
+    }
+  }
+  device.Snapshot.PollCount++;
+  device.Snapshot.ErrCode = (writeResult != ModbusMaster::ku8MBSuccess) ? writeResult : result;
+  if (result == ModbusMaster::ku8MBSuccess)
+  {
+    device.Snapshot.TemperatureBoiler = temperature;
+    device.Snapshot.RelaisStatus = relaisStatus;
+    device.Snapshot.Timestamp = millis();
+  }
+  else
+  {
+    device.Snapshot.ErrorCount++;
+  }
+  unlock();
+}
+
+void EgoSmartHeaterMultiBus::setPowerNominalValue(int heater, int16_t value)
+{
+  if (heater < 0 || heater >= _heaterCount)
+    return;
+  lock();
+  _device[heater].PowerNominalValue = value;
+  _device[heater].Pending = true;
+  _newValue[_device[heater].Snapshot.Bus] = true;
+  unlock();
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  _wake.notify_all();
+#endif
+}
+
+bool EgoSmartHeaterMultiBus::getSnapshot(int heater, HeaterSnapshot_t &snapshot)
+{
+  if (heater < 0 || heater >= _heaterCount)
+    return false;
+  lock();
+  snapshot = _device[heater].Snapshot;
+  unlock();
+  return true;
+}
+
+uint8_t EgoSmartHeaterMultiBus::getSnapshots(HeaterSnapshot_t *snapshots, uint8_t max)
+{
+  uint8_t n = (max < _heaterCount) ? max : _heaterCount;
+
+  lock();
+  for (uint8_t h = 0; h < n; h++)
+  {
+    snapshots[h] = _device[h].Snapshot;
+  }
+  unlock();
+  return n;
+}
+
+uint8_t EgoSmartHeaterMultiBus::getHeaterCount()
+{
+  return _heaterCount;
+}
+
+uint32_t EgoSmartHeaterMultiBus::getPollCount()
+{
+  uint32_t count = 0;
+
+  lock();
+  for (uint8_t h = 0; h < _heaterCount; h++)
+  {
+    count += _device[h].Snapshot.PollCount;
+  }
+  unlock();
+  return count;
+}
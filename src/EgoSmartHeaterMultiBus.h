@@ -0,0 +1,162 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Concurrent polling of E.G.O. RS485 Smart Heaters connected to several RS485 buses.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_MULTIBUS_h
+#define EGO_SH_MULTIBUS_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#if defined(__linux__)
+#define EGO_SH_MULTIBUS_THREADS         // one thread per bus
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#elif defined(ESP32)
+#define EGO_SH_MULTIBUS_TASKS           // one FreeRTOS task per bus
+#endif
+//------------------------------------------------------------------------------
+#define EGO_SH_MULTIBUS_MAX_BUSES 4         // Maximum number of buses
+#define EGO_SH_MULTIBUS_MAX_HEATERS 16      // Maximum number of heaters on all buses
+#define EGO_SH_MULTIBUS_KEEPALIVE 30000     // Interval in milliseconds in which an activation is renewed
+#define EGO_SH_MULTIBUS_POLL_INTERVAL 1000  // Default interval in milliseconds between the starts of two rounds on a bus
+
+//------------------------------------------------------------------------------
+
+/// \struct HeaterSnapshot_t
+/// latest values of a heater, as polled by EgoSmartHeaterMultiBus
+struct HeaterSnapshot_t
+{
+  uint8_t Bus;
+  uint8_t SlaveId;
+  int16_t TemperatureBoiler;
+  uint16_t RelaisStatus;
+  int16_t PowerNominalValue;  // last value written, -99 if none
+  uint8_t ErrCode;            // result of the last poll
+  uint32_t Timestamp;         // millis() of the last successful poll
+  uint32_t PollCount;
+  uint32_t ErrorCount;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterMultiBus
+/// Polls heaters on several RS485 buses in parallel and keeps a registry with the latest snapshot of every heater.
+/// On Linux every bus is served by a thread, on ESP32 by a FreeRTOS task. On other platforms poll() serves all buses
+/// one after another from loop().
+/// A round polls every heater of a bus once, the rounds of a bus start every poll interval (setPollInterval). The
+/// workers sleep for the rest of the interval, a bus without heaters costs no CPU time.
+/// Power values set by setPowerNominalValue() are written by the bus worker and renewed every EGO_SH_MULTIBUS_KEEPALIVE.
+/// On Linux and with poll() a new value starts a round at once, on ESP32 it is written by the next round. A failed
+/// write is repeated by the next round.
+/// The buses must not use the manual DE/RE control of EgoSmartHeaterRS485, since its pin is shared by all instances.
+/// Use adapters with automatic direction control, the kernel RS485 mode on Linux or the RS485 half duplex mode of the ESP32 UART.
+class EgoSmartHeaterMultiBus
+{
+public:
+  EgoSmartHeaterMultiBus();
+  ~EgoSmartHeaterMultiBus();
+
+  /// @brief Register a bus.
+  /// @param serial is the serial interface of the bus.
+  /// @return index of the bus, -1 if EGO_SH_MULTIBUS_MAX_BUSES is exceeded.
+  int addBus(Stream &serial);
+  /// @brief Register a heater.
+  /// @param bus is the index returned by addBus().
+  /// @param slave is the modbus address of the heater (default: EGO_SH_RS485_MODBUS_ADR).
+  /// @return index of the heater in the registry, -1 if EGO_SH_MULTIBUS_MAX_HEATERS is exceeded.
+  int addHeater(uint8_t bus, uint8_t slave = EGO_SH_RS485_MODBUS_ADR);
+  /// @brief Configure the interval between the starts of two polling rounds of a bus. A round taking longer than the
+  /// interval is followed by the next one at once.
+  /// @param bus is the index returned by addBus().
+  /// @param interval is the interval in milliseconds (default: EGO_SH_MULTIBUS_POLL_INTERVAL, 0 = back to back).
+  /// @return false if the bus index is invalid.
+  bool setPollInterval(uint8_t bus, uint32_t interval);
+
+  /// @brief Start the workers. Buses and heaters must be registered before.
+  /// @return true if the workers have been started, false if this platform has no threads (use poll() instead).
+  bool start();
+  /// @brief Stop the workers and wait until they finished.
+  void stop();
+  /// @brief Serve all buses whose poll interval has elapsed, one after another. For platforms without threads.
+  void poll();
+
+  /// @brief Configure the PowerNominalValue of a heater. The value is written by the bus worker and renewed periodically.
+  /// @param heater is the index returned by addHeater().
+  /// @param value is the power in Watts, see EgoSmartHeaterRS485::setPowerNominalValue.
+  void setPowerNominalValue(int heater, int16_t value);
+  /// @brief Retrieve the latest values of a heater.
+  /// @param heater is the index returned by addHeater().
+  /// @param snapshot is the structure to be filled.
+  /// @return true if the index is valid.
+  bool getSnapshot(int heater, HeaterSnapshot_t &snapshot);
+  /// @brief Retrieve the latest values of all heaters.
+  /// @param snapshots is an array receiving the snapshots, ordered by heater index.
+  /// @param max is the size of the array.
+  /// @return number of snapshots copied.
+  uint8_t getSnapshots(HeaterSnapshot_t *snapshots, uint8_t max);
+  /// @return Number of registered heaters.
+  uint8_t getHeaterCount();
+  /// @return Number of polls performed on all buses.
+  uint32_t getPollCount();
+
+protected:
+  struct Device_t
+  {
+    HeaterSnapshot_t Snapshot;
+    int16_t PowerNominalValue;
+    bool Pending;
+    uint32_t LastActivation;
+  };
+
+  Stream *_serial[EGO_SH_MULTIBUS_MAX_BUSES];
+  uint32_t _pollInterval[EGO_SH_MULTIBUS_MAX_BUSES];
+  uint32_t _nextRound[EGO_SH_MULTIBUS_MAX_BUSES];
+  bool _newValue[EGO_SH_MULTIBUS_MAX_BUSES];    // a power value was set since the start of the last round
+  EgoSmartHeaterRS485 _heater[EGO_SH_MULTIBUS_MAX_BUSES];
+  Device_t _device[EGO_SH_MULTIBUS_MAX_HEATERS];
+  uint8_t _busCount = 0;
+  uint8_t _heaterCount = 0;
+
+#if defined(EGO_SH_MULTIBUS_THREADS)
+  std::thread _worker[EGO_SH_MULTIBUS_MAX_BUSES];
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::atomic<bool> _running;
+#elif defined(EGO_SH_MULTIBUS_TASKS)
+  struct Worker_t
+  {
+    EgoSmartHeaterMultiBus *Self;
+    uint8_t Bus;
+  };
+  Worker_t _worker[EGO_SH_MULTIBUS_MAX_BUSES];
+  SemaphoreHandle_t _mutex;
+  volatile bool _running = false;
+  volatile uint8_t _activeWorkers = 0;
+  static void runTask(void *parameter);
+#else
+  bool _running = false;
+#endif
+
+  void lock();
+  void unlock();
+  void runBus(uint8_t bus);
+  void waitForRound(uint8_t bus, uint32_t start);
+  void pollBus(uint8_t bus);
+  void pollHeater(uint8_t bus, uint8_t heater);
+};
+
+#endif //EGO_SH_MULTIBUS_h
@@ -0,0 +1,229 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Adaptive poll scheduler for E.G.O. RS485 Smart Heaters.
+ * Predicts the boiler temperature by a thermal model and polls more often only near threshold crossings.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterPollScheduler.h"
+#include <Arduino.h>
+
+static const float MillisPerHour = 3600000.0f;
+static const float FitWeight = 0.25f;     // weight of a new rate sample in the moving average
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterPollScheduler::EgoSmartHeaterPollScheduler()
+{
+  _minInterval = EGO_SH_SCHED_MIN_INTERVAL;
+  _maxInterval = EGO_SH_SCHED_MAX_INTERVAL;
+}
+
+void EgoSmartHeaterPollScheduler::setInterval(uint32_t minInterval, uint32_t maxInterval)
+{
+  _minInterval = minInterval;
+  _maxInterval = (maxInterval < minInterval) ? minInterval : maxInterval;
+}
+
+/*
+ * TemperatureNominalValue 0 means the potentiometer sets the nominal temperature.
+ */
+void EgoSmartHeaterPollScheduler::setThresholds(const TemperatureConfig_t &config, int16_t userTemperatureNominal)
+{
+  clearThresholds();
+  if (config.TemperatureMinValue != 0)
+    addThreshold(config.TemperatureMinValue);
+  if (config.TemperatureNominalValue != 0)
+    addThreshold(config.TemperatureNominalValue);
+  else
+    addThreshold(userTemperatureNominal);
+  addThreshold(config.TemperatureMaxValue);
+}
+
+bool EgoSmartHeaterPollScheduler::addThreshold(int16_t temperature)
+{
+  if (_thresholdCount >= EGO_SH_SCHED_MAX_THRESHOLDS)
+    return false;
+  _threshold[_thresholdCount++] = temperature;
+  return true;
+}
+
+void EgoSmartHeaterPollScheduler::clearThresholds()
+{
+  _thresholdCount = 0;
+}
+
+void EgoSmartHeaterPollScheduler::setModel(float heatingRate, float coolingRate)
+{
+  _heatingRate = heatingRate;
+  _coolingRate = coolingRate;
+  _heatingSamples = 1;
+  _coolingSamples = 1;
+}
+
+/*
+ * The reported temperature has a resolution of 1K, so a rate is only measured between two polls which saw the reported
+ * value change, with the same relais status in between. The first change after a status change or an unexpected
+ * event just sets the anchor. The prediction is kept within +-0.5K of the reported value, which tracks the temperature
+ * below the resolution of the register.
+ */
+void EgoSmartHeaterPollScheduler::update(uint32_t now, int16_t temperature, uint16_t relaisStatus)
+{
+  uint8_t step = relaisStatus & 0x07;
+  bool unexpected = false;
+
+  if (!_valid)
+  {
+    _estimate = temperature;
+    _step = step;
+    _anchored = false;
+    _valid = true;
+  }
+  else
+  {
+    float predicted = getPredictedTemperature(now);
+    bool fitted = (_step == 0) ? (_coolingSamples > 0) : (_heatingSamples > 0);
+    unexpected = fitted && fabs(predicted - temperature) > EGO_SH_SCHED_TOLERANCE;
+
+    if (unexpected || step != _step)
+    {
+      _anchored = false;
+    }
+    else if (temperature != _lastTemperature)
+    {
+      if (_anchored && now != _anchorTime)
+        fit(step, (temperature - _anchorTemperature) * MillisPerHour / (float)(now - _anchorTime));
+      _anchored = true;
+      _anchorTime = now;
+      _anchorTemperature = temperature;
+    }
+
+    if (unexpected)
+      _estimate = temperature;
+    else
+      _estimate = constrain(predicted, temperature - 0.5f, temperature + 0.5f);
+    _step = step;
+  }
+
+  _lastTime = now;
+  _lastTemperature = temperature;
+  schedule(now);
+  // the model doesn't describe the boiler at the moment, e.g. while hot water is drawn
+  if (unexpected)
+    _nextPoll = now + _minInterval;
+}
+
+void EgoSmartHeaterPollScheduler::setRelaisStatus(uint32_t now, uint16_t relaisStatus)
+{
+  uint8_t step = relaisStatus & 0x07;
+
+  if (!_valid || step == _step)
+    return;
+  _estimate = getPredictedTemperature(now);
+  _lastTime = now;
+  _step = step;
+  _anchored = false;
+  schedule(now);
+}
+
+bool EgoSmartHeaterPollScheduler::isDue(uint32_t now)
+{
+  return !_valid || (int32_t)(now - _nextPoll) >= 0;
+}
+
+uint32_t EgoSmartHeaterPollScheduler::getNextPoll()
+{
+  return _nextPoll;
+}
+
+float EgoSmartHeaterPollScheduler::getPredictedTemperature(uint32_t now)
+{
+  return _estimate + getRate(_step) * (float)(now - _lastTime) / MillisPerHour;
+}
+
+float EgoSmartHeaterPollScheduler::getHeatingRate()
+{
+  return _heatingRate;
+}
+
+float EgoSmartHeaterPollScheduler::getCoolingRate()
+{
+  return _coolingRate;
+}
+
+/*
+ * As long as a rate isn't fitted the worst case EGO_SH_SCHED_MAX_RATE is assumed, which keeps the interval short near
+ * the thresholds until the model is known.
+ */
+float EgoSmartHeaterPollScheduler::getRate(uint8_t step)
+{
+  if (step == 0)
+    return (_coolingSamples > 0) ? -_coolingRate : -EGO_SH_SCHED_MAX_RATE;
+  if (_heatingSamples == 0)
+    return EGO_SH_SCHED_MAX_RATE;
+  return step * _heatingRate - _coolingRate;
+}
+
+void EgoSmartHeaterPollScheduler::fit(uint8_t step, float rate)
+{
+  if (step == 0)
+  {
+    float cooling = (rate < 0) ? -rate : 0;
+    _coolingRate = (_coolingSamples == 0) ? cooling : _coolingRate + FitWeight * (cooling - _coolingRate);
+    if (_coolingSamples < 0xFFFF)
+      _coolingSamples++;
+  }
+  else
+  {
+    float heating = (rate + _coolingRate) / step;
+    if (heating < 0)
+      heating = 0;
+    _heatingRate = (_heatingSamples == 0) ? heating : _heatingRate + FitWeight * (heating - _heatingRate);
+    if (_heatingSamples < 0xFFFF)
+      _heatingSamples++;
+  }
+}
+
+/*
+ * A threshold is crossed once the temperature is within 0.5K of it, since the device reports whole degrees. The next
+ * poll is scheduled after half of the predicted time to the nearest crossing ahead, thresholds behind the current
+ * trend are ignored. A boiler at a threshold is polled after the shortest interval, whatever the trend, since the
+ * heater switches there.
+ */
+void EgoSmartHeaterPollScheduler::schedule(uint32_t now)
+{
+  float rate = getRate(_step);
+  float interval = _maxInterval;
+
+  for (uint8_t i = 0; i < _thresholdCount; i++)
+  {
+    float distance = _threshold[i] - _estimate;
+    float remaining = fabs(distance) - 0.5f;
+
+    if (remaining <= 0)
+    {
+      interval = _minInterval;
+      break;
+    }
+    if (rate == 0 || (distance > 0) != (rate > 0))
+      continue;
+
+    float time = remaining / fabs(rate) * MillisPerHour / 2;
+    if (time < interval)
+      interval = time;
+  }
+
+  if (interval < _minInterval)
+    interval = _minInterval;
+  _nextPoll = now + (uint32_t)interval;
+}
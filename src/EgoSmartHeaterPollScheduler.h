@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Adaptive poll scheduler for E.G.O. RS485 Smart Heaters.
+ * Predicts the boiler temperature by a thermal model and polls more often only near threshold crossings.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_POLL_SCHEDULER_h
+#define EGO_SH_POLL_SCHEDULER_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+//------------------------------------------------------------------------------
+#define EGO_SH_SCHED_MAX_THRESHOLDS 4         // Maximum number of temperature thresholds
+#define EGO_SH_SCHED_MIN_INTERVAL 5000        // Default shortest poll interval in milliseconds
+#define EGO_SH_SCHED_MAX_INTERVAL 300000      // Default longest poll interval in milliseconds
+#define EGO_SH_SCHED_MAX_RATE 30.0f           // Rate in K/h assumed as long as the model isn't fitted
+#define EGO_SH_SCHED_TOLERANCE 2.0f           // Deviation from the prediction in K which is treated as unexpected event
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterPollScheduler
+/// Decides when the boiler temperature of a Smart Heater has to be polled next.
+/// The scheduler keeps a linear thermal model of the boiler: the temperature rises by HeatingRate for every 500W step
+/// switched on and falls by CoolingRate (both in K/h). The rates are fitted from the polled temperatures, measured
+/// between two changes of the reported temperature while the relais status stays the same.
+/// Based on the model the time until the next threshold (e.g. TemperatureMaxValue) is reached is predicted. The next
+/// poll is scheduled after half of that time, so the interval shrinks towards EGO_SH_SCHED_MIN_INTERVAL close to the
+/// crossing and grows up to EGO_SH_SCHED_MAX_INTERVAL while the boiler is far away from any threshold.
+/// If a polled temperature deviates from the prediction by more than EGO_SH_SCHED_TOLERANCE (e.g. hot water is drawn),
+/// the sample is not used for the model and the next poll is scheduled after the shortest interval.
+/// The class only does the calculation, all times are passed in milliseconds (e.g. millis()).
+class EgoSmartHeaterPollScheduler
+{
+public:
+  /// @brief Constructor to setup the scheduler with default intervals and an unfitted model.
+  EgoSmartHeaterPollScheduler();
+
+  /// @brief Configure the limits of the poll interval.
+  /// @param minInterval is the shortest interval in milliseconds (default: EGO_SH_SCHED_MIN_INTERVAL).
+  /// @param maxInterval is the longest interval in milliseconds (default: EGO_SH_SCHED_MAX_INTERVAL).
+  void setInterval(uint32_t minInterval, uint32_t maxInterval);
+  /// @brief Replace the thresholds by TemperatureMinValue (if not 0), the nominal temperature and TemperatureMaxValue.
+  /// @param config is the temperature configuration of the heater (see getTemperatureConfig).
+  /// @param userTemperatureNominal is the potentiometer position (see getUserTemperatureNominal), the nominal
+  /// temperature if TemperatureNominalValue is 0.
+  void setThresholds(const TemperatureConfig_t &config, int16_t userTemperatureNominal);
+  /// @brief Add a temperature threshold.
+  /// @param temperature is the threshold in °C.
+  /// @return false if EGO_SH_SCHED_MAX_THRESHOLDS are already set.
+  bool addThreshold(int16_t temperature);
+  /// @brief Remove all thresholds.
+  void clearThresholds();
+  /// @brief Set a fitted model, e.g. restored after a reboot.
+  /// @param heatingRate is the temperature rise per 500W step in K/h.
+  /// @param coolingRate is the temperature loss in K/h.
+  void setModel(float heatingRate, float coolingRate);
+
+  /// @brief Pass the result of a poll. Fits the model and schedules the next poll.
+  /// @param now is the time of the poll in milliseconds.
+  /// @param temperature is the result of getActualTemperatureBoiler().
+  /// @param relaisStatus is the result of getRelaisStatus().
+  void update(uint32_t now, int16_t temperature, uint16_t relaisStatus);
+  /// @brief Pass a change of the relais status without a poll, e.g. after setPowerNominalValue(). Reschedules the next poll.
+  /// @param now is the time of the change in milliseconds.
+  /// @param relaisStatus is the new relais bitfield.
+  void setRelaisStatus(uint32_t now, uint16_t relaisStatus);
+  /// @brief Check if the next poll is due.
+  /// @param now is the current time in milliseconds.
+  /// @return true if the temperature should be polled now.
+  bool isDue(uint32_t now);
+
+  /// @return Time of the next poll in milliseconds.
+  uint32_t getNextPoll();
+  /// @brief Predict the boiler temperature based on the last poll and the model.
+  /// @param now is the time of the prediction in milliseconds.
+  /// @return Temperature in °C
+  float getPredictedTemperature(uint32_t now);
+  /// @return Fitted temperature rise per 500W step in K/h, 0 if not fitted yet.
+  float getHeatingRate();
+  /// @return Fitted temperature loss in K/h, 0 if not fitted yet.
+  float getCoolingRate();
+
+protected:
+  uint32_t _minInterval;
+  uint32_t _maxInterval;
+  int16_t _threshold[EGO_SH_SCHED_MAX_THRESHOLDS];
+  uint8_t _thresholdCount = 0;
+
+  float _heatingRate = 0;
+  float _coolingRate = 0;
+  uint16_t _heatingSamples = 0;
+  uint16_t _coolingSamples = 0;
+
+  bool _valid = false;          // a poll was passed
+  uint32_t _lastTime = 0;       // time of the last poll
+  float _estimate = 0;          // temperature at _lastTime
+  int16_t _lastTemperature = 0;
+  uint8_t _step = 0;            // 500W steps switched on
+  bool _anchored = false;       // _anchorTime is a change of the reported temperature
+  uint32_t _anchorTime = 0;
+  int16_t _anchorTemperature = 0;
+  uint32_t _nextPoll = 0;
+
+  float getRate(uint8_t step);
+  void fit(uint8_t step, float rate);
+  void schedule(uint32_t now);
+};
+
+#endif //EGO_SH_POLL_SCHEDULER_h
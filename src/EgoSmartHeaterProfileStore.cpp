@@ -0,0 +1,286 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Persistent cache for E.G.O. Smart Heater device profiles.
+ * Backends for EEPROM and LittleFS (ESP8266, ESP32) as well as plain files on Linux.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterProfileStore.h"
+#if EGO_SH_FEATURE_IDENTITY
+#include "EgoSmartHeaterModbusRtu.h"
+#include <Arduino.h>
+#ifdef EGO_SH_PROFILE_EEPROM
+#include <EEPROM.h>
+#endif
+#ifdef EGO_SH_PROFILE_LITTLEFS
+#include <LittleFS.h>
+#endif
+#ifdef EGO_SH_PROFILE_FILE
+#include <stdio.h>
+#endif
+
+/*
+ * Record layout, all values little endian:
+ *   0 magic (2), 2 version (1), 3 slave ID (1), 4 VendorName (32), 36 ProductName (32), 68 SerialNumber (32),
+ *   100 ProductionDate (4), 104 RelaisCount (2), 106 3x RelaisSetup (6 each), 124 CRC (2)
+ */
+static uint8_t *putUint16(uint8_t *p, uint16_t value)
+{
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+  return p + 2;
+}
+
+static uint8_t *putUint32(uint8_t *p, uint32_t value)
+{
+  p = putUint16(p, value & 0xFFFF);
+  return putUint16(p, value >> 16);
+}
+
+static const uint8_t *takeUint16(const uint8_t *p, uint16_t &value)
+{
+  value = p[0] | (p[1] << 8);
+  return p + 2;
+}
+
+static const uint8_t *takeUint32(const uint8_t *p, uint32_t &value)
+{
+  uint16_t low, high;
+  p = takeUint16(p, low);
+  p = takeUint16(p, high);
+  value = ((uint32_t)high << 16) | low;
+  return p;
+}
+
+//------------------------------------------------------------------------------
+bool EgoSmartHeaterProfileStore::load(uint8_t slave, DeviceProfile_t &profile)
+{
+  uint8_t data[EGO_SH_PROFILE_RECORD_SIZE];
+
+  if (!readRecord(slave, data, sizeof(data)))
+    return false;
+  if (!deserialise(data, profile))
+    return false;
+  return profile.SlaveId == slave;
+}
+
+bool EgoSmartHeaterProfileStore::save(const DeviceProfile_t &profile)
+{
+  uint8_t data[EGO_SH_PROFILE_RECORD_SIZE];
+
+  serialise(profile, data);
+  return writeRecord(profile.SlaveId, data, sizeof(data));
+}
+
+void EgoSmartHeaterProfileStore::serialise(const DeviceProfile_t &profile, uint8_t data[EGO_SH_PROFILE_RECORD_SIZE])
+{
+  uint8_t *p = data;
+
+  p = putUint16(p, EGO_SH_PROFILE_MAGIC);
+  *p++ = EGO_SH_PROFILE_VERSION;
+  *p++ = profile.SlaveId;
+  memcpy(p, profile.VendorName, EGO_SH_RS485_STRING_LEN);
+  p += EGO_SH_RS485_STRING_LEN;
+  memcpy(p, profile.ProductName, EGO_SH_RS485_STRING_LEN);
+  p += EGO_SH_RS485_STRING_LEN;
+  memcpy(p, profile.SerialNumber, EGO_SH_RS485_STRING_LEN);
+  p += EGO_SH_RS485_STRING_LEN;
+  p = putUint32(p, profile.ProductionDate);
+  p = putUint16(p, profile.RelaisCount);
+  for (int r = 0; r < 3; r++)
+  {
+    p = putUint16(p, profile.RelaisSetup[r].ActualPower);
+    p = putUint16(p, profile.RelaisSetup[r].MinOnTime);
+    p = putUint16(p, profile.RelaisSetup[r].MinOffTime);
+  }
+  putUint16(p, EgoSmartHeaterModbusRtu::crc16(data, p - data));
+}
+
+bool EgoSmartHeaterProfileStore::deserialise(const uint8_t data[EGO_SH_PROFILE_RECORD_SIZE], DeviceProfile_t &profile)
+{
+  const uint8_t *p = data;
+  uint16_t magic, crc;
+
+  p = takeUint16(p, magic);
+  if (magic != EGO_SH_PROFILE_MAGIC || *p++ != EGO_SH_PROFILE_VERSION)
+    return false;
+  takeUint16(data + EGO_SH_PROFILE_RECORD_SIZE - 2, crc);
+  if (crc != EgoSmartHeaterModbusRtu::crc16(data, EGO_SH_PROFILE_RECORD_SIZE - 2))
+    return false;
+
+  memset(&profile, 0, sizeof(profile));
+  profile.SlaveId = *p++;
+  memcpy(profile.VendorName, p, EGO_SH_RS485_STRING_LEN);
+  p += EGO_SH_RS485_STRING_LEN;
+  memcpy(profile.ProductName, p, EGO_SH_RS485_STRING_LEN);
+  p += EGO_SH_RS485_STRING_LEN;
+  memcpy(profile.SerialNumber, p, EGO_SH_RS485_STRING_LEN);
+  p += EGO_SH_RS485_STRING_LEN;
+  p = takeUint32(p, profile.ProductionDate);
+  p = takeUint16(p, profile.RelaisCount);
+  for (int r = 0; r < 3; r++)
+  {
+    p = takeUint16(p, profile.RelaisSetup[r].ActualPower);
+    p = takeUint16(p, profile.RelaisSetup[r].MinOnTime);
+    p = takeUint16(p, profile.RelaisSetup[r].MinOffTime);
+  }
+  return true;
+}
+
+#ifdef EGO_SH_PROFILE_EEPROM
+//------------------------------------------------------------------------------
+// EEPROM backend
+EgoSmartHeaterEepromStore::EgoSmartHeaterEepromStore(int address, uint8_t slots)
+{
+  _address = address;
+  _slots = slots;
+}
+
+/*
+ * Returns the slot which contains the record of the slave. If allocate is set, a free slot (or slot 0) is returned if no record exists.
+ */
+int EgoSmartHeaterEepromStore::findSlot(uint8_t slave, bool allocate)
+{
+  int freeSlot = -1;
+
+  for (int i = 0; i < _slots; i++)
+  {
+    int a = _address + i * EGO_SH_PROFILE_RECORD_SIZE;
+    uint16_t magic = EEPROM.read(a) | (EEPROM.read(a + 1) << 8);
+
+    if (magic == EGO_SH_PROFILE_MAGIC && EEPROM.read(a + 3) == slave)
+      return i;
+    if (magic != EGO_SH_PROFILE_MAGIC && freeSlot < 0)
+      freeSlot = i;
+  }
+  if (!allocate)
+    return -1;
+  return (freeSlot < 0) ? 0 : freeSlot;
+}
+
+bool EgoSmartHeaterEepromStore::readRecord(uint8_t slave, uint8_t *data, size_t len)
+{
+  int slot = findSlot(slave, false);
+
+  if (slot < 0)
+    return false;
+  for (size_t i = 0; i < len; i++)
+  {
+    data[i] = EEPROM.read(_address + slot * EGO_SH_PROFILE_RECORD_SIZE + i);
+  }
+  return true;
+}
+
+bool EgoSmartHeaterEepromStore::writeRecord(uint8_t slave, const uint8_t *data, size_t len)
+{
+  int slot = findSlot(slave, true);
+
+  for (size_t i = 0; i < len; i++)
+  {
+    // update only changed cells to save write cycles
+    int a = _address + slot * EGO_SH_PROFILE_RECORD_SIZE + i;
+    if (EEPROM.read(a) != data[i])
+      EEPROM.write(a, data[i]);
+  }
+#if defined(ESP8266) || defined(ESP32)
+  return EEPROM.commit();
+#else
+  return true;
+#endif
+}
+#endif
+
+#ifdef EGO_SH_PROFILE_LITTLEFS
+//------------------------------------------------------------------------------
+// LittleFS backend
+EgoSmartHeaterLittleFsStore::EgoSmartHeaterLittleFsStore(const char *prefix)
+{
+  _prefix = prefix;
+}
+
+bool EgoSmartHeaterLittleFsStore::readRecord(uint8_t slave, uint8_t *data, size_t len)
+{
+  String name = String(_prefix) + String(slave) + ".bin";
+  File file = LittleFS.open(name, "r");
+
+  if (!file)
+    return false;
+  size_t n = file.read(data, len);
+  file.close();
+  return n == len;
+}
+
+bool EgoSmartHeaterLittleFsStore::writeRecord(uint8_t slave, const uint8_t *data, size_t len)
+{
+  String name = String(_prefix) + String(slave) + ".bin";
+  File file = LittleFS.open(name, "w");
+
+  if (!file)
+    return false;
+  size_t n = file.write(data, len);
+  file.close();
+  return n == len;
+}
+#endif
+
+#ifdef EGO_SH_PROFILE_FILE
+//------------------------------------------------------------------------------
+// File backend
+EgoSmartHeaterFileStore::EgoSmartHeaterFileStore(const char *directory)
+{
+  _directory = directory;
+}
+
+void EgoSmartHeaterFileStore::getFileName(uint8_t slave, char *name, size_t len)
+{
+  snprintf(name, len, "%s/egosh_%u.bin", _directory, slave);
+}
+
+bool EgoSmartHeaterFileStore::readRecord(uint8_t slave, uint8_t *data, size_t len)
+{
+  char name[256];
+  getFileName(slave, name, sizeof(name));
+
+  FILE *file = fopen(name, "rb");
+  if (file == NULL)
+    return false;
+  size_t n = fread(data, 1, len, file);
+  fclose(file);
+  return n == len;
+}
+
+/*
+ * The record is written to a temporary file first and renamed afterwards, so that a power loss never leaves a partial record.
+ */
+bool EgoSmartHeaterFileStore::writeRecord(uint8_t slave, const uint8_t *data, size_t len)
+{
+  char name[256];
+  char tmpName[260];
+  getFileName(slave, name, sizeof(name));
+  snprintf(tmpName, sizeof(tmpName), "%s.tmp", name);
+
+  FILE *file = fopen(tmpName, "wb");
+  if (file == NULL)
+    return false;
+  size_t n = fwrite(data, 1, len, file);
+  if (fclose(file) != 0 || n != len)
+  {
+    remove(tmpName);
+    return false;
+  }
+  return rename(tmpName, name) == 0;
+}
+#endif
+
+#endif //EGO_SH_FEATURE_IDENTITY
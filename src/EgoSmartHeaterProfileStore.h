@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Persistent cache for E.G.O. Smart Heater device profiles.
+ * Backends for EEPROM and LittleFS (ESP8266, ESP32) as well as plain files on Linux.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_PROFILE_STORE_h
+#define EGO_SH_PROFILE_STORE_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#if EGO_SH_FEATURE_IDENTITY
+//------------------------------------------------------------------------------
+#if defined(ESP8266) || defined(ESP32) || defined(ARDUINO_ARCH_AVR)
+#define EGO_SH_PROFILE_EEPROM           // EgoSmartHeaterEepromStore available
+#endif
+#if defined(ESP8266) || defined(ESP32)
+#define EGO_SH_PROFILE_LITTLEFS         // EgoSmartHeaterLittleFsStore available
+#endif
+#if defined(__linux__)
+#define EGO_SH_PROFILE_FILE             // EgoSmartHeaterFileStore available
+#endif
+
+#define EGO_SH_PROFILE_MAGIC 0xE605     // Identifies a valid profile record
+#define EGO_SH_PROFILE_VERSION 2        // Incremented whenever the record layout changes
+#define EGO_SH_PROFILE_RECORD_SIZE 126  // Size of a serialised profile in bytes
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterProfileStore
+/// Base class of all profile stores. Serialises a DeviceProfile_t into a fixed, platform independent record
+/// which is protected by a CRC. The backends only need to provide reading and writing of the raw record.
+///
+/// Typical boot sequence:
+/// load the profile for the slave ID, validate it with EgoSmartHeaterRS485::validateDeviceProfile (a single read)
+/// and only if this fails read the complete profile by EgoSmartHeaterRS485::readDeviceProfile and save it.
+class EgoSmartHeaterProfileStore
+{
+public:
+  virtual ~EgoSmartHeaterProfileStore() {}
+
+  /// @brief Load the cached profile of a device.
+  /// @param slave is the modbus address of the device.
+  /// @param profile is the structure to be filled.
+  /// @return true if a valid record for this slave ID has been found.
+  bool load(uint8_t slave, DeviceProfile_t &profile);
+  /// @brief Store the profile of a device. An existing record of the same slave ID is replaced.
+  /// @param profile is the profile to be stored, typically read by EgoSmartHeaterRS485::readDeviceProfile.
+  /// @return true if the record has been written.
+  bool save(const DeviceProfile_t &profile);
+
+protected:
+  /// @brief Read the raw record of a slave ID from the backend.
+  virtual bool readRecord(uint8_t slave, uint8_t *data, size_t len) = 0;
+  /// @brief Write the raw record of a slave ID to the backend.
+  virtual bool writeRecord(uint8_t slave, const uint8_t *data, size_t len) = 0;
+
+  static void serialise(const DeviceProfile_t &profile, uint8_t data[EGO_SH_PROFILE_RECORD_SIZE]);
+  static bool deserialise(const uint8_t data[EGO_SH_PROFILE_RECORD_SIZE], DeviceProfile_t &profile);
+};
+
+#ifdef EGO_SH_PROFILE_EEPROM
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterEepromStore
+/// Stores the profiles in consecutive EEPROM slots of EGO_SH_PROFILE_RECORD_SIZE bytes.
+/// On ESP8266 and ESP32 EEPROM.begin() has to be called with a sufficient size before using the store.
+class EgoSmartHeaterEepromStore : public EgoSmartHeaterProfileStore
+{
+public:
+  /// @brief Constructor to setup the EEPROM area used by the store.
+  /// @param address is the first EEPROM address used by the store.
+  /// @param slots is the number of profiles which can be stored (default: 1).
+  EgoSmartHeaterEepromStore(int address, uint8_t slots = 1);
+
+protected:
+  int _address;
+  uint8_t _slots;
+
+  bool readRecord(uint8_t slave, uint8_t *data, size_t len) override;
+  bool writeRecord(uint8_t slave, const uint8_t *data, size_t len) override;
+  int findSlot(uint8_t slave, bool allocate);
+};
+#endif
+
+#ifdef EGO_SH_PROFILE_LITTLEFS
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterLittleFsStore
+/// Stores every profile in a separate LittleFS file. LittleFS.begin() has to be called before using the store.
+class EgoSmartHeaterLittleFsStore : public EgoSmartHeaterProfileStore
+{
+public:
+  /// @brief Constructor to setup the file name prefix.
+  /// @param prefix is prepended to the slave ID to build the file name (default: "/egosh_").
+  EgoSmartHeaterLittleFsStore(const char *prefix = "/egosh_");
+
+protected:
+  const char *_prefix;
+
+  bool readRecord(uint8_t slave, uint8_t *data, size_t len) override;
+  bool writeRecord(uint8_t slave, const uint8_t *data, size_t len) override;
+};
+#endif
+
+#ifdef EGO_SH_PROFILE_FILE
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterFileStore
+/// Stores every profile in a separate file of a directory.
+class EgoSmartHeaterFileStore : public EgoSmartHeaterProfileStore
+{
+public:
+  /// @brief Constructor to setup the directory.
+  /// @param directory is the existing directory which receives the profile files (default: current directory).
+  EgoSmartHeaterFileStore(const char *directory = ".");
+
+protected:
+  const char *_directory;
+
+  bool readRecord(uint8_t slave, uint8_t *data, size_t len) override;
+  bool writeRecord(uint8_t slave, const uint8_t *data, size_t len) override;
+  void getFileName(uint8_t slave, char *name, size_t len);
+};
+#endif
+
+#endif //EGO_SH_FEATURE_IDENTITY
+#endif //EGO_SH_PROFILE_STORE_h
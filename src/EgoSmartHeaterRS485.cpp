@@ -22,6 +22,48 @@
 #include "EgoSmartHeaterRS485.h"
 #include <Arduino.h>
 #include "ModbusMaster.h"
+#include "EgoSmartHeaterDecoder.h"
+#include <stddef.h>
+
+#if EGO_SH_FEATURE_TELEMETRY
+// RestartCounter .. ActualTemperaturPCB (0x1202 - 0x1205)
+static const DecodeField_t RestartFields[] = {
+  {0, EGO_SH_DECODE_UINT32, offsetof(OperatingData_t, RestartCounter)},
+  {3, EGO_SH_DECODE_INT16, offsetof(OperatingData_t, TemperaturePCB)}};
+
+// TotalOperatingSeconds .. RelaisOperatingTime (0x1400 - 0x140E)
+static const DecodeField_t OperatingFields[] = {
+  {0, EGO_SH_DECODE_UINT32, offsetof(OperatingData_t, TotalOperatingSeconds)},
+  {2, EGO_SH_DECODE_UINT32, offsetof(OperatingData_t, ErrorCounter)},
+  {4, EGO_SH_DECODE_INT16, offsetof(OperatingData_t, TemperatureBoiler)},
+  {5, EGO_SH_DECODE_INT16, offsetof(OperatingData_t, TemperatureExternalSensor1)},
+  {6, EGO_SH_DECODE_INT16, offsetof(OperatingData_t, TemperatureExternalSensor2)},
+  {7, EGO_SH_DECODE_INT16, offsetof(OperatingData_t, UserTemperatureNominal)},
+  {8, EGO_SH_DECODE_UINT16, offsetof(OperatingData_t, RelaisStatus)},
+  {9, EGO_SH_DECODE_UINT32, offsetof(OperatingData_t, OperatingTime.OperatingSeconds1)},
+  {11, EGO_SH_DECODE_UINT32, offsetof(OperatingData_t, OperatingTime.OperatingSeconds2)},
+  {13, EGO_SH_DECODE_UINT32, offsetof(OperatingData_t, OperatingTime.OperatingSeconds3)}};
+#endif
+
+#if EGO_SH_FEATURE_ERROR_LOG
+// a single error entry (4 registers)
+static const DecodeField_t ErrorFields[] = {
+  {0, EGO_SH_DECODE_UINT32, offsetof(ErrorData_t, OperatingHour)},
+  {2, EGO_SH_DECODE_UINT16, offsetof(ErrorData_t, OperatingSecond)},
+  {3, EGO_SH_DECODE_UINT16, offsetof(ErrorData_t, ErrorCode)}};
+#endif
+
+#if EGO_SH_FEATURE_TELEMETRY
+// a relais configuration block (7 registers)
+static const DecodeField_t RelaisFields[] = {
+  {0, EGO_SH_DECODE_UINT16, offsetof(RelaisConfigurationData_t, ActualPower)},
+  {1, EGO_SH_DECODE_UINT32, offsetof(RelaisConfigurationData_t, OperatingSeconds)},
+  {3, EGO_SH_DECODE_UINT32, offsetof(RelaisConfigurationData_t, SwitchingCycles)},
+  {5, EGO_SH_DECODE_UINT16, offsetof(RelaisConfigurationData_t, MinOnTime)},
+  {6, EGO_SH_DECODE_UINT16, offsetof(RelaisConfigurationData_t, MinOffTime)}};
+#endif
+
+#define FIELD_COUNT(fields) (sizeof(fields) / sizeof(fields[0]))
 
 // I don't like this, but value is required in the call back functions
 int ego_sh_dere_pin = D0;
@@ -73,6 +115,7 @@ void EgoSmartHeaterRS485::begin(Stream &serial)
  */
 void EgoSmartHeaterRS485::begin(Stream &serial, uint8_t slave)
 {
+  _slave = slave;
   _node.begin(slave, serial);
 
   if(this->manualDere)
@@ -100,103 +143,84 @@ void EgoSmartHeaterRS485::clearErrCode()
 
 float EgoSmartHeaterRS485::getModbusFloat(uint16_t data[2])
 {
-  union u_data
-  {
-    byte b[4];
-    uint16_t data[2];
-  } source;
-
-  union u_tag
-  {
-    byte b[4];
-    float val;
-  } dest;
-
-  source.data[0] = data[0];
-  source.data[1] = data[1];
-
-  dest.b[2] = source.b[0];
-  dest.b[3] = source.b[1];
-  dest.b[0] = source.b[2];
-  dest.b[1] = source.b[3];
-
-  return dest.val;
+  return EgoSmartHeaterDecoder::toFloat(data[0], data[1]);
 }
 
 uint32_t EgoSmartHeaterRS485::getModbusUint32(uint16_t data[2])
 {
-  union u_data
-  {
-    byte b[4];
-    uint16_t data[2];
-  } source;
-
-  union u_tag
-  {
-    byte b[4];
-    uint32_t val;
-  } dest;
+  return EgoSmartHeaterDecoder::toUint32(data[0], data[1]);
+}
 
-  source.data[0] = data[0];
-  source.data[1] = data[1];
+int32_t EgoSmartHeaterRS485::getModbusInt32(uint16_t data[2])
+{
+  return EgoSmartHeaterDecoder::toInt32(data[0], data[1]);
+}
 
-  dest.b[2] = source.b[0];
-  dest.b[3] = source.b[1];
-  dest.b[0] = source.b[2];
-  dest.b[1] = source.b[3];
+#if EGO_SH_FEATURE_IDENTITY
+String EgoSmartHeaterRS485::getModbusString32(uint16_t data[16])
+{
+  char text[EGO_SH_RS485_STRING_LEN + 1];
 
-  return dest.val;
+  EgoSmartHeaterDecoder::toChars(data, 16, text);
+  return String(text);
 }
+#endif
 
-int32_t EgoSmartHeaterRS485::getModbusInt32(uint16_t data[2])
+/*
+ * Copies the response of a read into data, to be decoded by EgoSmartHeaterDecoder::decodeBlock.
+ */
+uint8_t EgoSmartHeaterRS485::readRegisters(uint16_t reg, uint8_t qty, uint16_t *data)
 {
-  union u_data
-  {
-    byte b[4];
-    uint16_t data[2];
-  } source;
+  _result = _node.readHoldingRegisters(reg, qty);
 
-  union u_tag
+  // do something with data if read is successful
+  if (_result == _node.ku8MBSuccess)
   {
-    byte b[4];
-    int32_t val;
-  } dest;
-
-  source.data[0] = data[0];
-  source.data[1] = data[1];
+    for (uint8_t j = 0; j < qty; j++)
+    {
+      data[j] = _node.getResponseBuffer(j);
+    }
+  }
+  return _result;
+}
 
-  dest.b[2] = source.b[0];
-  dest.b[3] = source.b[1];
-  dest.b[0] = source.b[2];
-  dest.b[1] = source.b[3];
+#if EGO_SH_FEATURE_IDENTITY
+uint8_t EgoSmartHeaterRS485::readModbusChars(uint16_t reg, char text[EGO_SH_RS485_STRING_LEN + 1])
+{
+  uint16_t data[16];
 
-  return dest.val;
+  text[0] = 0;
+  if (readRegisters(reg, 16, data) == _node.ku8MBSuccess)
+    EgoSmartHeaterDecoder::toChars(data, 16, text);
+  return _result;
 }
+#endif
 
-String EgoSmartHeaterRS485::getModbusString32(uint16_t data[16])
+/*
+ * Decodes a 32 bit value starting at offset of the last response.
+ */
+uint32_t EgoSmartHeaterRS485::getResponseUint32(uint8_t offset)
 {
-  union u_data
-  {
-    byte b[32];
-    uint16_t data[16];
-  } source;
+  return EgoSmartHeaterDecoder::toUint32(_node.getResponseBuffer(offset), _node.getResponseBuffer(offset + 1));
+}
 
-  String text = "";
-  String chr = " ";
-  
-  for(int i=0; i<16; i++)
-  {
-    source.data[i] = data[i];
-  }
+#if EGO_SH_FEATURE_TELEMETRY
+/*
+ * Decodes a relais configuration block starting at offset of the last response.
+ */
+RelaisConfigurationData_t EgoSmartHeaterRS485::getRelaisConfigurationResponse(uint8_t offset)
+{
+  uint16_t data[RelaisConfigurationLength];
+  RelaisConfigurationData_t result;
 
-  for(int i=0; (i<32 && source.b[i] != 0x0); i++)
+  for (uint8_t j = 0; j < RelaisConfigurationLength; j++)
   {
-    chr.setCharAt(0, source.b[i]);
-    text.concat(chr);
+    data[j] = _node.getResponseBuffer(offset + j);
   }
-
-  return text;
+  EgoSmartHeaterDecoder::decodeBlock(data, RelaisConfigurationLength, RelaisFields, FIELD_COUNT(RelaisFields), &result);
+  return result;
 }
+#endif
 
 //------------------------------------------------------------------------------
 // Basic Device Information
@@ -256,6 +280,7 @@ uint16_t EgoSmartHeaterRS485::getFirmwareVersion()
   return result;
 }
 
+#if EGO_SH_FEATURE_IDENTITY
 String EgoSmartHeaterRS485::getVendorName()
 {
   uint8_t j;
@@ -336,27 +361,68 @@ uint32_t EgoSmartHeaterRS485::getProductionDate()
   }
   return result;
 }
+#endif
 
+#if EGO_SH_FEATURE_TELEMETRY
 RelaisConfigurationData_t EgoSmartHeaterRS485::getRelaisConfiguration(int r)
 {
-  uint16_t data[2];
   RelaisConfigurationData_t result;
 
-  _result = _node.readHoldingRegisters(RegisterRelaisConfiguration[r], 7);
+  memset(&result, 0, sizeof(result));
+  if (r < 0 || r >= EGO_SH_RS485_RELAIS_COUNT)
+  {
+    _result = EGO_SH_RS485_INVALID_VALUE;
+    return result;
+  }
+
+  _result = _node.readHoldingRegisters(RegisterRelaisConfiguration[r], RelaisConfigurationLength);
 
   // do something with data if read is successful
   if (_result == _node.ku8MBSuccess)
   {
-    result.ActualPower = _node.getResponseBuffer(0);
-    data[0] = _node.getResponseBuffer(1);
-    data[1] = _node.getResponseBuffer(2);
-    result.OperatingSeconds = getModbusUint32(data);
-    data[0] = _node.getResponseBuffer(3);
-    data[1] = _node.getResponseBuffer(4);
-    result.SwitchingCycles = getModbusUint32(data);
-    result.MinOnTime = _node.getResponseBuffer(5);
-    result.MinOffTime = _node.getResponseBuffer(6);
+    result = getRelaisConfigurationResponse(0);
+  }
+  return result;
+}
+
+/*
+ * The registers between the blocks (0x1007 - 0x101F, 0x1027 - 0x103F) are not readable, a read across them is refused
+ * with an illegal data address. So only adjacent ranges are merged and every block costs a request of its own.
+ */
+RelaisConfigurationSet_t EgoSmartHeaterRS485::getRelaisConfigurations()
+{
+  RegisterRange_t ranges[EGO_SH_RS485_RELAIS_COUNT];
+  RegisterRange_t reads[EGO_SH_RS485_RELAIS_COUNT];
+  RelaisConfigurationSet_t result;
+  uint8_t error = _node.ku8MBSuccess;
+  uint8_t n;
+
+  memset(&result, 0, sizeof(result));
+  for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+  {
+    ranges[r].Register = RegisterRelaisConfiguration[r];
+    ranges[r].Count = RelaisConfigurationLength;
   }
+  n = EgoSmartHeaterReadPlan::plan(ranges, EGO_SH_RS485_RELAIS_COUNT, reads, EGO_SH_RS485_RELAIS_COUNT, 0);
+
+  for (uint8_t i = 0; i < n; i++)
+  {
+    _result = _node.readHoldingRegisters(reads[i].Register, reads[i].Count);
+
+    for (int r = 0; r < EGO_SH_RS485_RELAIS_COUNT; r++)
+    {
+      if (!EgoSmartHeaterReadPlan::contains(reads[i], ranges[r]))
+        continue;
+      if (_result == _node.ku8MBSuccess)
+      {
+        result.Relais[r] = getRelaisConfigurationResponse(ranges[r].Register - reads[i].Register);
+        result.Valid[r] = true;
+      }
+      if (!result.Valid[r] && error == _node.ku8MBSuccess)
+        error = _result;
+    }
+  }
+  _result = error;
   return result;
 }
 
@@ -373,6 +439,53 @@ uint16_t EgoSmartHeaterRS485::getRelaisCount()
   }
   return result;
 }
+#endif
+
+
+#if EGO_SH_FEATURE_IDENTITY
+/*
+ * Reads all static device information. Stops at the first failing read, the error code is returned and stored as usual.
+ */
+uint8_t EgoSmartHeaterRS485::readDeviceProfile(DeviceProfile_t &profile)
+{
+  memset(&profile, 0, sizeof(profile));
+  profile.SlaveId = _slave;
+
+  if (readModbusChars(RegisterVendorName, profile.VendorName) != _node.ku8MBSuccess)
+    return _result;
+  if (readModbusChars(RegisterProductName, profile.ProductName) != _node.ku8MBSuccess)
+    return _result;
+  if (readModbusChars(RegisterSerialNumber, profile.SerialNumber) != _node.ku8MBSuccess)
+    return _result;
+
+  profile.ProductionDate = getProductionDate();
+  if (_result != _node.ku8MBSuccess)
+    return _result;
+  profile.RelaisCount = getRelaisCount();
+  if (_result != _node.ku8MBSuccess)
+    return _result;
+
+  RelaisConfigurationSet_t relais = getRelaisConfigurations();
+  for (int r = 0; r < 3; r++)
+  {
+    profile.RelaisSetup[r].ActualPower = relais.Relais[r].ActualPower;
+    profile.RelaisSetup[r].MinOnTime = relais.Relais[r].MinOnTime;
+    profile.RelaisSetup[r].MinOffTime = relais.Relais[r].MinOffTime;
+  }
+  return _result;
+}
+
+bool EgoSmartHeaterRS485::validateDeviceProfile(const DeviceProfile_t &profile)
+{
+  char serialNumber[EGO_SH_RS485_STRING_LEN + 1];
+
+  if (profile.SlaveId != _slave || profile.SerialNumber[0] == 0)
+    return false;
+  if (readModbusChars(RegisterSerialNumber, serialNumber) != _node.ku8MBSuccess)
+    return false;
+  return strncmp(serialNumber, profile.SerialNumber, EGO_SH_RS485_STRING_LEN) == 0;
+}
+#endif
 
 
 //------------------------------------------------------------------------------
@@ -391,6 +504,7 @@ uint16_t EgoSmartHeaterRS485::getTemperatureMinValue()
   return result;
 }
 
+#if EGO_SH_FEATURE_SETUP
 uint8_t EgoSmartHeaterRS485::setTemperatureMinValue(uint16_t value)
 {
   _node.setTransmitBuffer(0, value);
@@ -398,6 +512,7 @@ uint8_t EgoSmartHeaterRS485::setTemperatureMinValue(uint16_t value)
   _result = _node.writeMultipleRegisters(RegisterTemperatureMinValue, 1);
   return _result;
 }
+#endif
 
 uint16_t EgoSmartHeaterRS485::getTemperatureMaxValue()
 {
@@ -413,6 +528,7 @@ uint16_t EgoSmartHeaterRS485::getTemperatureMaxValue()
   return result;
 }
 
+#if EGO_SH_FEATURE_SETUP
 uint8_t EgoSmartHeaterRS485::setTemperatureMaxValue(uint16_t value)
 {
   _node.setTransmitBuffer(0, value);
@@ -420,6 +536,7 @@ uint8_t EgoSmartHeaterRS485::setTemperatureMaxValue(uint16_t value)
   _result = _node.writeMultipleRegisters(RegisterTemperatureMaxValue, 1);
   return _result;
 }
+#endif
 
 uint16_t EgoSmartHeaterRS485::getTemperatureNominalValue()
 {
@@ -435,6 +552,7 @@ uint16_t EgoSmartHeaterRS485::getTemperatureNominalValue()
   return result;
 }
 
+#if EGO_SH_FEATURE_SETUP
 uint8_t EgoSmartHeaterRS485::setTemperatureNominalValue(uint16_t value)
 {
   _node.setTransmitBuffer(0, value);
@@ -442,6 +560,61 @@ uint8_t EgoSmartHeaterRS485::setTemperatureNominalValue(uint16_t value)
   _result = _node.writeMultipleRegisters(RegisterTemperatureNominalValue, 1);
   return _result;
 }
+#endif
+
+TemperatureConfig_t EgoSmartHeaterRS485::getTemperatureConfig()
+{
+  TemperatureConfig_t result;
+
+  result.TemperatureMinValue = -1;
+  result.TemperatureMaxValue = -1;
+  result.TemperatureNominalValue = -1;
+
+  _result = _node.readHoldingRegisters(RegisterTemperatureMinValue, 3);
+
+  // do something with data if read is successful
+  if (_result == _node.ku8MBSuccess)
+  {
+    result.TemperatureMinValue = _node.getResponseBuffer(0);
+    result.TemperatureMaxValue = _node.getResponseBuffer(1);
+    result.TemperatureNominalValue = _node.getResponseBuffer(2);
+  }
+  return result;
+}
+
+uint8_t EgoSmartHeaterRS485::setTemperatureConfig(const TemperatureConfig_t &config, int16_t userTemperatureNominal)
+{
+  if (!checkTemperatureConfig(config, userTemperatureNominal))
+  {
+    _result = EGO_SH_RS485_INVALID_VALUE;
+    return _result;
+  }
+
+  _node.setTransmitBuffer(0, config.TemperatureMinValue);
+  _node.setTransmitBuffer(1, config.TemperatureMaxValue);
+  _node.setTransmitBuffer(2, config.TemperatureNominalValue);
+
+  _result = _node.writeMultipleRegisters(RegisterTemperatureMinValue, 3);
+  return _result;
+}
+
+uint8_t EgoSmartHeaterRS485::setTemperatureConfig(const TemperatureConfig_t &config)
+{
+  int16_t userTemperatureNominal = getUserTemperatureNominal();
+
+  if (_result != _node.ku8MBSuccess)
+    return _result;
+  return setTemperatureConfig(config, userTemperatureNominal);
+}
+
+bool EgoSmartHeaterRS485::checkTemperatureConfig(const TemperatureConfig_t &config, int16_t userTemperatureNominal)
+{
+  if (config.TemperatureMinValue != 0 && (int32_t)config.TemperatureMinValue > userTemperatureNominal - 10)
+    return false;
+  if (config.TemperatureNominalValue != 0 && (int32_t)config.TemperatureNominalValue > userTemperatureNominal)
+    return false;
+  return true;
+}
 
 int16_t EgoSmartHeaterRS485::getPowerNominalValue()
 {
@@ -494,8 +667,14 @@ uint8_t EgoSmartHeaterRS485::setHomeTotalPower(int32_t value)
   return _result;
 }
 
+#if EGO_SH_FEATURE_SETUP
 uint8_t EgoSmartHeaterRS485::setRelaisMinOnTime(int r, uint16_t value)
 {
+  if (r < 0 || r >= EGO_SH_RS485_RELAIS_COUNT)
+  {
+    _result = EGO_SH_RS485_INVALID_VALUE;
+    return _result;
+  }
   _node.setTransmitBuffer(0, value);
 
   _result = _node.writeMultipleRegisters(RegisterRelaisConfiguration[r]+5, 1);
@@ -504,15 +683,22 @@ uint8_t EgoSmartHeaterRS485::setRelaisMinOnTime(int r, uint16_t value)
 
 uint8_t EgoSmartHeaterRS485::setRelaisMinOffTime(int r, uint16_t value)
 {
+  if (r < 0 || r >= EGO_SH_RS485_RELAIS_COUNT)
+  {
+    _result = EGO_SH_RS485_INVALID_VALUE;
+    return _result;
+  }
   _node.setTransmitBuffer(0, value);
 
   _result = _node.writeMultipleRegisters(RegisterRelaisConfiguration[r]+6, 1);
   return _result;
 }
+#endif
 
 
 //------------------------------------------------------------------------------
 // Operating Information
+#if EGO_SH_FEATURE_TELEMETRY
 uint32_t EgoSmartHeaterRS485::getRestartCounter()
 {
   uint8_t j;
@@ -585,6 +771,7 @@ uint32_t EgoSmartHeaterRS485::getErrorCounter()
   }
   return result;
 }
+#endif
 
 int16_t EgoSmartHeaterRS485::getActualTemperatureBoiler()
 {
@@ -600,6 +787,7 @@ int16_t EgoSmartHeaterRS485::getActualTemperatureBoiler()
   return result;
 }
 
+#if EGO_SH_FEATURE_TELEMETRY
 int16_t EgoSmartHeaterRS485::getActualTemperatureExternalSensor1()
 {
   int16_t result = -1;
@@ -627,6 +815,7 @@ int16_t EgoSmartHeaterRS485::getActualTemperatureExternalSensor2()
   }
   return result;
 }
+#endif
 
 int16_t EgoSmartHeaterRS485::getUserTemperatureNominal()
 {
@@ -655,37 +844,69 @@ uint16_t EgoSmartHeaterRS485::getRelaisStatus()
   return result;
 }
 
+#if EGO_SH_FEATURE_TELEMETRY
+/*
+ * The three counters are adjacent (0x1409 - 0x140E) and read by a single request.
+ */
 RelaisOperatingTime_t EgoSmartHeaterRS485::getRelaisOperatingTime()
 {
-  uint8_t j;
   uint16_t data[2];
-  uint32_t result = 0;
   RelaisOperatingTime_t rot;
 
-  for(int i=0; i<3; i++) {
-    _result = _node.readHoldingRegisters(RegisterRelaisOperatingTime[i], 2);
-  
-    // do something with data if read is successful
-    if (_result == _node.ku8MBSuccess)
+  memset(&rot, 0, sizeof(rot));
+  _result = _node.readHoldingRegisters(RegisterRelaisOperatingTime[0], 6);
+
+  // do something with data if read is successful
+  if (_result == _node.ku8MBSuccess)
+  {
+    data[0] = _node.getResponseBuffer(0);
+    data[1] = _node.getResponseBuffer(1);
+    rot.OperatingSeconds1 = getModbusUint32(data);
+    data[0] = _node.getResponseBuffer(2);
+    data[1] = _node.getResponseBuffer(3);
+    rot.OperatingSeconds2 = getModbusUint32(data);
+    data[0] = _node.getResponseBuffer(4);
+    data[1] = _node.getResponseBuffer(5);
+    rot.OperatingSeconds3 = getModbusUint32(data);
+  }
+  return rot;
+}
+
+OperatingData_t EgoSmartHeaterRS485::getOperatingData()
+{
+  uint16_t data[15];
+  OperatingData_t result;
+
+  memset(&result, 0, sizeof(result));
+  if (readRegisters(RegisterRestartCounter, 4, data) != _node.ku8MBSuccess)
+    return result;
+  EgoSmartHeaterDecoder::decodeBlock(data, 4, RestartFields, FIELD_COUNT(RestartFields), &result);
+
+  if (readRegisters(RegisterTotalOperatingSeconds, 15, data) != _node.ku8MBSuccess)
+  {
+    memset(&result, 0, sizeof(result));
+    return result;
+  }
+  EgoSmartHeaterDecoder::decodeBlock(data, 15, OperatingFields, FIELD_COUNT(OperatingFields), &result);
+  return result;
+}
+#endif
+
+#if EGO_SH_FEATURE_ERROR_LOG
+ErrorLog_t EgoSmartHeaterRS485::getErrorLog()
+{
+  uint16_t data[40];
+  ErrorLog_t result;
+
+  memset(&result, 0, sizeof(result));
+  if (readRegisters(RegisterErrorData[0], 40, data) == _node.ku8MBSuccess)
+  {
+    for (int i = 0; i < 10; i++)
     {
-      for (j = 0; j < 2; j++)
-      {
-        data[j] = _node.getResponseBuffer(j);
-      }
-      switch(i){
-        case 0:
-          rot.OperatingSeconds1 = getModbusUint32(data);
-          break;
-        case 1:
-          rot.OperatingSeconds2 = getModbusUint32(data);
-          break;
-        case 2:
-          rot.OperatingSeconds3 = getModbusUint32(data);
-          break;
-      }
+      EgoSmartHeaterDecoder::decodeBlock(&data[4 * i], 4, ErrorFields, FIELD_COUNT(ErrorFields), &result.Error[i]);
     }
   }
-  return rot;
+  return result;
 }
 
 ErrorData_t EgoSmartHeaterRS485::getError(int i)
@@ -706,6 +927,7 @@ ErrorData_t EgoSmartHeaterRS485::getError(int i)
   }
   return result;  
 }
+#endif
 
 
 #endif //__EGO_SH_RS485_H__
@@ -21,9 +21,15 @@
 //------------------------------------------------------------------------------
 #include <Arduino.h>
 #include <ModbusMaster.h>
+#include "EgoSmartHeaterConfig.h"
+#include "EgoSmartHeaterReadPlan.h"
 //------------------------------------------------------------------------------
 #define EGO_SH_RS485_SERIAL_BAUD 19200
 #define EGO_SH_RS485_MODBUS_ADR 247     // Modbus address of EGO Smart Heaters
+#define EGO_SH_RS485_STRING_LEN 32      // Length of the identity strings (16 registers)
+#define EGO_SH_RS485_INVALID_VALUE 0xF0 // Result code if a value is refused by the library before sending it
+#define EGO_SH_RS485_CANCELLED 0xF1     // Result code of a transaction cancelled before the response was received
+#define EGO_SH_RS485_RELAIS_COUNT 3     // Number of relais (500W, 1000W, 2000W)
 
 //------------------------------------------------------------------------------
 
@@ -38,6 +44,14 @@ struct RelaisConfigurationData_t
   uint16_t MinOffTime;
 };
 
+/// \struct RelaisConfigurationSet_t
+/// setup of all relais, Valid[r] is false if the block of relais r couldn't be read
+struct RelaisConfigurationSet_t
+{
+  RelaisConfigurationData_t Relais[EGO_SH_RS485_RELAIS_COUNT];
+  bool Valid[EGO_SH_RS485_RELAIS_COUNT];
+};
+
 /// \struct ErrorData_t
 /// record set of a single error entry
 struct ErrorData_t
@@ -56,10 +70,68 @@ struct RelaisOperatingTime_t
   uint32_t OperatingSeconds3;
 };
 
+/// \struct OperatingData_t
+/// operating information (0x1202 - 0x1205, 0x1400 - 0x140E), read by two requests
+struct OperatingData_t
+{
+  uint32_t RestartCounter;
+  int16_t TemperaturePCB;
+  uint32_t TotalOperatingSeconds;
+  uint32_t ErrorCounter;
+  int16_t TemperatureBoiler;
+  int16_t TemperatureExternalSensor1;
+  int16_t TemperatureExternalSensor2;
+  int16_t UserTemperatureNominal;
+  uint16_t RelaisStatus;
+  RelaisOperatingTime_t OperatingTime;
+};
+
+/// \struct ErrorLog_t
+/// all entries of the error log (0x1500 - 0x1527)
+struct ErrorLog_t
+{
+  ErrorData_t Error[10];
+};
+
+/// \struct TemperatureConfig_t
+/// temperature configuration block (0x1209 - 0x120B)
+struct TemperatureConfig_t
+{
+  uint16_t TemperatureMinValue;
+  uint16_t TemperatureMaxValue;
+  uint16_t TemperatureNominalValue;
+};
+
+#if EGO_SH_FEATURE_IDENTITY
+/// \struct RelaisSetup_t
+/// configuration of a specific relais without the wear counters
+struct RelaisSetup_t
+{
+  uint16_t ActualPower;
+  uint16_t MinOnTime;
+  uint16_t MinOffTime;
+};
+
+/// \struct DeviceProfile_t
+/// static identity and setup of a device, which can be cached to speed up the boot. The wear counters
+/// (OperatingSeconds, SwitchingCycles) change all the time and are not part of it, read them by getRelaisConfigurations.
+struct DeviceProfile_t
+{
+  uint8_t SlaveId;
+  char VendorName[EGO_SH_RS485_STRING_LEN + 1];
+  char ProductName[EGO_SH_RS485_STRING_LEN + 1];
+  char SerialNumber[EGO_SH_RS485_STRING_LEN + 1];
+  uint32_t ProductionDate;
+  uint16_t RelaisCount;
+  RelaisSetup_t RelaisSetup[3];
+};
+#endif
+
 //------------------------------------------------------------------------------
 /// \class EgoSmartHeaterRS485
 /// E.G.O. Smart Heater control
 /// Controls SmartHeater product code 29.65335.000 and RS-485 module for Arduino (MAX485) on multiple architectures
+/// The functions available depend on the build profile and features selected in EgoSmartHeaterConfig.h.
 class EgoSmartHeaterRS485
 {
 public:
@@ -98,6 +170,7 @@ public:
   /// @brief Retrieve FirmwareVersion (0x2003)
   /// @return Firmware-Revision (e.g. 0x64 = 100 = 1.00)
   uint16_t getFirmwareVersion();
+#if EGO_SH_FEATURE_IDENTITY
   /// @brief Retrieve VendorName (0x2013)
   /// @return Vendor name as a string (Example: E.G.O.)
   String getVendorName();
@@ -110,41 +183,86 @@ public:
   /// @brief Retrieve ProductionDate (0x2035)
   /// @return Date of when device was assembled. This field is BCD-encoded and thus can be interpreted as a string with a fixed length. (Example: 0x20140515)
   uint32_t getProductionDate();
+#endif
+#if EGO_SH_FEATURE_TELEMETRY
   /// @brief Retrieve details for a particular relais (0x1000, 0x1020, 0x1040)
   /// @param Number of the relais to query (0: 500W, 1: 1000W, 2: 2000W)
-  /// @return Structure which contains ActualPower, OperatingSeconds, SwitchingCycles, MinOnTime, MinOffTime
+  /// @return Structure which contains ActualPower, OperatingSeconds, SwitchingCycles, MinOnTime, MinOffTime. All values are 0 if the read failed or r is out of range.
   RelaisConfigurationData_t getRelaisConfiguration(int r);
+  /// @brief Retrieve details for all relais (0x1000, 0x1020, 0x1040). The registers between the blocks are not readable,
+  /// so every block is read by a request of its own.
+  /// @return Structure which contains the configuration and a validity flag for every relais. getErrCode() returns the first error.
+  RelaisConfigurationSet_t getRelaisConfigurations();
   /// @brief Retrieve RelaisCount (0x1204)
   /// @return Number of relais available in this product. Should be 3.
   uint16_t getRelaisCount();
+#endif
+#if EGO_SH_FEATURE_IDENTITY
+  /// @brief Retrieve the complete device profile (VendorName, ProductName, SerialNumber, ProductionDate, RelaisCount and the configuration of all relais).
+  /// The profile might be stored by an EgoSmartHeaterProfileStore to avoid reading it at every boot.
+  /// @param profile is the structure to be filled.
+  /// @return result code of the modbus read operations (see ModBus libary)
+  uint8_t readDeviceProfile(DeviceProfile_t &profile);
+  /// @brief Check if a cached device profile belongs to the connected device, using a single read of the SerialNumber (0x2024).
+  /// @param profile is the cached profile.
+  /// @return true if slave ID and SerialNumber match the connected device.
+  bool validateDeviceProfile(const DeviceProfile_t &profile);
+#endif
 
   // Configuration Information
   /// @brief Retrieve TemperatureMinValue (0x1209).
   /// Below this temperature the heater will warm the boiler even if no solar power is available. This can be used by the consumer to ensure a minimum water temperature in the boiler. 0 = Off, otherwise value has to be at least 10K below the actual setting of the Potentiometer.
   /// @return Temperature in °C
   uint16_t getTemperatureMinValue();
+#if EGO_SH_FEATURE_SETUP
   /// @brief Configure TemperatureMinValue (0x1209).
   /// Below this temperature the heater will warm the boiler even if no solar power is available. This can be used by the consumer to ensure a minimum water temperature in the boiler. 0 = Off, otherwise value has to be at least 10K below the actual setting of the Potentiometer.
   /// @param value is the Temperature in °C to be applied 
   /// @return result code of the modbus write operation (see ModBus libary)
   uint8_t setTemperatureMinValue(uint16_t value);
+#endif
   /// @brief Retrieve TemperatureMaxValue (0x120A). The maximum specified allowed water temperature which will not exceeded by the smart heater even if the potentiometer is in the maximum position.
   /// @return Temperature in °C
   uint16_t getTemperatureMaxValue();
+#if EGO_SH_FEATURE_SETUP
   /// @brief Configure TemperatureMaxValue (0x120A).
   /// The maximum specified allowed water temperature which will not exceeded by the smart heater even if the potentiometer is in the maximum position.
   /// @param value is the Temperature in °C to be applied 
   /// @return result code of the modbus write operation (see ModBus libary)
   uint8_t setTemperatureMaxValue(uint16_t value);
+#endif
   /// @brief Retrieve TemperatureNominalValue (0x120B).
   /// This is the desired water temperature of the consumer. The special value zero means that the optional hardware potentiometer should be used by the regulator. The value of this potentiometer is available in register “UserTemperaturNominalValue”. The maximum value must not be higher than “UserTemperaturNominalValue”.
   /// @return Temperature in °C
   uint16_t getTemperatureNominalValue();
+#if EGO_SH_FEATURE_SETUP
   /// @brief Configure TemperatureNominalValue (0x120B).
   /// This is the desired water temperature of the consumer. The special value zero means that the optional hardware potentiometer should be used by the regulator. The value of this potentiometer is available in register “UserTemperaturNominalValue”. The maximum value must not be higher than “UserTemperaturNominalValue”.
   /// @param value is the Temperature in °C to be applied 
   /// @return result code of the modbus write operation (see ModBus libary)
   uint8_t setTemperatureNominalValue(uint16_t value);
+#endif
+  /// @brief Retrieve TemperatureMinValue, TemperatureMaxValue and TemperatureNominalValue (0x1209 - 0x120B) by a single request.
+  /// @return Structure which contains the three temperatures in °C
+  TemperatureConfig_t getTemperatureConfig();
+  /// @brief Configure TemperatureMinValue, TemperatureMaxValue and TemperatureNominalValue (0x1209 - 0x120B) by a single request.
+  /// The configuration is checked by checkTemperatureConfig before, nothing is sent if it would be refused by the device.
+  /// @param config contains the temperatures in °C to be applied
+  /// @param userTemperatureNominal is the potentiometer setting (see getUserTemperatureNominal), known by the caller
+  /// @return result code of the modbus write operation (see ModBus libary), EGO_SH_RS485_INVALID_VALUE if the configuration is invalid
+  uint8_t setTemperatureConfig(const TemperatureConfig_t &config, int16_t userTemperatureNominal);
+  /// @brief Configure TemperatureMinValue, TemperatureMaxValue and TemperatureNominalValue (0x1209 - 0x120B) by a single request.
+  /// Reads the potentiometer setting (0x1407) first, to check the configuration by checkTemperatureConfig.
+  /// @param config contains the temperatures in °C to be applied
+  /// @return result code of the modbus operations (see ModBus libary), EGO_SH_RS485_INVALID_VALUE if the configuration is invalid
+  uint8_t setTemperatureConfig(const TemperatureConfig_t &config);
+  /// @brief Check a temperature configuration against the rules of the protocol description:
+  /// TemperatureMinValue is 0 (Off) or at least 10K below the potentiometer setting,
+  /// TemperatureNominalValue is 0 (potentiometer) or not higher than the potentiometer setting.
+  /// @param config contains the temperatures in °C to be checked
+  /// @param userTemperatureNominal is the potentiometer setting (see getUserTemperatureNominal)
+  /// @return true if the device will accept the configuration
+  static bool checkTemperatureConfig(const TemperatureConfig_t &config, int16_t userTemperatureNominal);
   /// @brief Retrieve PowerNominalValue (0x1300).
   /// This is the desired power value which the heater should use to heat the boiler. The special value -1 means, that the heater should use the HomeTotalPower value and use as much power as possible. When writing this value the heater will match the desired value itself to the available relais and constraints (minimum switch on times etc.). Therefore this register is threat on a best-effort basis.
   /// @return Power in Watts.
@@ -162,6 +280,7 @@ public:
   /// @param value is the power in Watts 
   /// @return result code of the modbus write operation (see ModBus libary)
   uint8_t setHomeTotalPower(int32_t value);
+#if EGO_SH_FEATURE_SETUP
   /// @brief Configure relais MinOnTime for a specific relais (0x1005, 0x1025, 0x1045).
   /// This field defines the minimum time the relais remains switched on.
   /// @param Number of the relais to query (0: 500W, 1: 1000W, 2: 2000W)
@@ -174,8 +293,10 @@ public:
   /// @param Minimum on-time in seconds.
   /// @return result code of the modbus write operation (see ModBus libary)
   uint8_t setRelaisMinOffTime(int r, uint16_t value);
+#endif
   
   // Operating Information
+#if EGO_SH_FEATURE_TELEMETRY
   /// @brief Retrieve RestartCounter (0x1202)
   /// This is mainly used during development.
   /// @return Number of the restarts of the smart heater’s internal controller.
@@ -190,9 +311,11 @@ public:
   /// @brief Retrieve ErrorCounter (0x1402)
   /// @return Number of errors
   uint32_t getErrorCounter();
+#endif
   /// @brief Retrieve ActualTemperaturBoiler (0x1404)
   /// @return Actual water temperature in the boiler in °C
   int16_t getActualTemperatureBoiler();
+#if EGO_SH_FEATURE_TELEMETRY
   /// @brief Retrieve ActualTemperaturExternalSensor1 (0x1405)
   /// This is the actual temperature of an (optional) first external temperature sensor. Special values:
   /// 0x8000 – no sensor can be attached to this heater model
@@ -207,6 +330,7 @@ public:
   /// 0x8002 – sensor present but malfunctioning
   /// @return Temperature in °C
   int16_t getActualTemperatureExternalSensor2();
+#endif
   /// @brief Retrieve UserTemperaturNominalValue (0x1407)
   /// This value corresponds to the position of an (optional) potentiometer where the consumer can select a desired boiler temperature.
   /// @return Temperature in °C
@@ -220,23 +344,42 @@ public:
   /// 0x0005: relais 1 + 3 is switched on
   /// @return Relais Status
   uint16_t getRelaisStatus();
-  /// @brief Retrieve the operating times of all relais (0x1409, 0x140B, 0x140D)
-  /// @return Counter of operating seconds for the three relais.
+#if EGO_SH_FEATURE_TELEMETRY
+  /// @brief Retrieve the operating times of all relais (0x1409, 0x140B, 0x140D) by a single request.
+  /// @return Counter of operating seconds for the three relais, all 0 if the read failed.
   RelaisOperatingTime_t getRelaisOperatingTime();
+  /// @brief Retrieve all operating information by two requests (0x1202 - 0x1205, 0x1400 - 0x140E).
+  /// @return Structure which contains the counters, temperatures, relais status and operating times, all 0 if a read failed.
+  OperatingData_t getOperatingData();
+#endif
+#if EGO_SH_FEATURE_ERROR_LOG
+  /// @brief Retrieve all entries of the error log by a single request (0x1500 - 0x1527).
+  /// @return Structure which contains the 10 error entries, all 0 if the read failed.
+  ErrorLog_t getErrorLog();
   /// @brief Retrieve error struct (0x1500 - 0x1526)
   /// @param i is the number of error message (0 - 9)
   /// @return struct which contains OperatingHour, OperatingSecond and ErrorCode
   ErrorData_t getError(int i);
+#endif
 
 protected:
   // instantiate ModbusMaster object
   ModbusMaster _node;
   uint8_t _result = _node.ku8MBSuccess; // Value: 0=Success, 2=Illegal Address, 3=Illegal Value
+  uint8_t _slave = EGO_SH_RS485_MODBUS_ADR;
 
   float getModbusFloat(uint16_t data[2]);
   uint32_t getModbusUint32(uint16_t data[2]);
   int32_t getModbusInt32(uint16_t data[2]);
+  uint32_t getResponseUint32(uint8_t offset);
+  uint8_t readRegisters(uint16_t reg, uint8_t qty, uint16_t *data);
+#if EGO_SH_FEATURE_IDENTITY
   String getModbusString32(uint16_t data[16]);
+  uint8_t readModbusChars(uint16_t reg, char text[EGO_SH_RS485_STRING_LEN + 1]);
+#endif
+#if EGO_SH_FEATURE_TELEMETRY
+  RelaisConfigurationData_t getRelaisConfigurationResponse(uint8_t offset);
+#endif
 
   //Basic Device Information
   static const uint16_t RegisterManufacturerId = 0x2000;
@@ -248,6 +391,7 @@ protected:
   static const uint16_t RegisterSerialNumber = 0x2024;
   static const uint16_t RegisterProductionDate = 0x2034;
   static constexpr uint16_t RegisterRelaisConfiguration[3] = {0x1000,0x1020,0x1040};
+  static const uint16_t RelaisConfigurationLength = 7;
   static const uint16_t RegisterRelaisCount = 0x1204;
 
   // Configuration Information
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Read planner for E.G.O. RS485 Smart Heaters.
+ * Combines register ranges into as few modbus read requests as possible.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterReadPlan.h"
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+uint8_t EgoSmartHeaterReadPlan::plan(const RegisterRange_t *ranges, uint8_t count, RegisterRange_t *reads, uint8_t maxReads,
+                                     uint16_t maxGap, uint16_t maxRead)
+{
+  uint8_t n = 0;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint32_t end = (uint32_t)ranges[i].Register + ranges[i].Count;
+
+    if (ranges[i].Count == 0)
+      continue;
+    if (ranges[i].Count > maxRead)
+      return 0;
+
+    // extend the current request if the gap is small enough and the request doesn't get too long
+    if (n > 0)
+    {
+      RegisterRange_t &read = reads[n - 1];
+      uint32_t readEnd = (uint32_t)read.Register + read.Count;
+
+      if (end <= readEnd)
+        continue;
+      if (ranges[i].Register <= readEnd + maxGap && end - read.Register <= maxRead)
+      {
+        read.Count = end - read.Register;
+        continue;
+      }
+    }
+
+    if (n >= maxReads)
+      return 0;
+    reads[n].Register = ranges[i].Register;
+    reads[n].Count = ranges[i].Count;
+    n++;
+  }
+  return n;
+}
+
+bool EgoSmartHeaterReadPlan::contains(const RegisterRange_t &read, const RegisterRange_t &range)
+{
+  return range.Register >= read.Register &&
+         (uint32_t)range.Register + range.Count <= (uint32_t)read.Register + read.Count;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Read planner for E.G.O. RS485 Smart Heaters.
+ * Combines register ranges into as few modbus read requests as possible.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_READ_PLAN_h
+#define EGO_SH_READ_PLAN_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+//------------------------------------------------------------------------------
+#define EGO_SH_PLAN_MAX_READ 64     // Maximum registers of a single read, size of the ModbusMaster response buffer
+#define EGO_SH_PLAN_MAX_GAP 0       // Maximum number of unused registers read along instead of starting a new request
+
+//------------------------------------------------------------------------------
+
+/// \struct RegisterRange_t
+/// range of consecutive registers
+struct RegisterRange_t
+{
+  uint16_t Register;
+  uint16_t Count;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterReadPlan
+/// Plans the read requests for a set of register ranges. Neighbouring ranges are merged into one request if the gap
+/// between them is at most maxGap registers and the request doesn't exceed maxRead registers.
+/// At 19200 baud every request costs the frame overhead, two inter frame gaps and the response time of the device,
+/// which is more bus time than reading a few dozen registers along. The Smart Heater refuses a whole read if it
+/// touches a register which is not mapped, so by default only adjacent ranges are merged. Pass a gap only if the
+/// registers in between are known to be readable.
+class EgoSmartHeaterReadPlan
+{
+public:
+  /// @brief Plan the read requests.
+  /// @param ranges are the register ranges to be read, in ascending order.
+  /// @param count is the number of ranges.
+  /// @param reads is an array receiving the requests.
+  /// @param maxReads is the size of the reads array.
+  /// @param maxGap is the maximum gap of readable registers to be merged (default: EGO_SH_PLAN_MAX_GAP, 0 = only adjacent ranges).
+  /// @param maxRead is the maximum number of registers of one request (default: EGO_SH_PLAN_MAX_READ).
+  /// @return Number of requests, 0 if the reads array is too small or a range exceeds maxRead.
+  static uint8_t plan(const RegisterRange_t *ranges, uint8_t count, RegisterRange_t *reads, uint8_t maxReads,
+                      uint16_t maxGap = EGO_SH_PLAN_MAX_GAP, uint16_t maxRead = EGO_SH_PLAN_MAX_READ);
+  /// @brief Check if a range is completely covered by a request.
+  /// @param read is the request.
+  /// @param range is the register range.
+  /// @return true if the request contains the range.
+  static bool contains(const RegisterRange_t &read, const RegisterRange_t &range);
+};
+
+#endif //EGO_SH_READ_PLAN_h
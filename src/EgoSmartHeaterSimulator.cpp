@@ -0,0 +1,566 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Simulated E.G.O. RS485 Smart Heater.
+ * Answers modbus RTU requests on a serial interface like a real device, for testing without hardware.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterSimulator.h"
+#include <Arduino.h>
+
+static const uint16_t RelaisPower[3] = {500, 1000, 2000};
+static const float BoilerCapacity = 837200.0;   // 200l water in J/K
+static const float CoolingRate = 0.00015;       // K/s at 40K above ambient
+
+//------------------------------------------------------------------------------
+EgoSmartHeaterSimulator::EgoSmartHeaterSimulator(uint8_t slave)
+{
+  _slave = slave;
+  setSerialNumber("30380912332211");
+  for (int r = 0; r < 3; r++)
+  {
+    _relais[r].ActualPower = RelaisPower[r];
+    _relais[r].OperatingSeconds = 0;
+    _relais[r].SwitchingCycles = 0;
+    _relais[r].MinOnTime = 10;
+    _relais[r].MinOffTime = 10;
+    _relaisChanged[r] = 0;
+  }
+  for (int f = 0; f < EGO_SH_SIM_FAULT_TYPES; f++)
+  {
+    _faultRate[f] = 0;
+    _faultCount[f] = 0;
+  }
+}
+
+void EgoSmartHeaterSimulator::begin(Stream &serial)
+{
+  _serial = &serial;
+  _length = 0;
+  _lastSecond = getTime();
+  _lastActivation = getTime();
+  for (int r = 0; r < 3; r++)
+  {
+    _relaisChanged[r] = getTime() - 1000UL * _relais[r].MinOffTime;
+  }
+}
+
+void EgoSmartHeaterSimulator::setSerialNumber(const char *serialNumber)
+{
+  memset(_serialNumber, 0, sizeof(_serialNumber));
+  strncpy(_serialNumber, serialNumber, sizeof(_serialNumber));
+}
+
+void EgoSmartHeaterSimulator::setUserTemperatureNominal(int16_t value)
+{
+  _userTemperatureNominal = value;
+}
+
+void EgoSmartHeaterSimulator::setTemperatureBoiler(float value)
+{
+  _temperatureBoiler = value;
+}
+
+void EgoSmartHeaterSimulator::setResponseDelay(uint16_t value)
+{
+  _responseDelay = value;
+}
+
+void EgoSmartHeaterSimulator::setFaultRate(uint8_t fault, uint16_t rate)
+{
+  if (fault < EGO_SH_SIM_FAULT_TYPES)
+    _faultRate[fault] = rate;
+}
+
+/*
+ * The simulated time continues from its current value, so the timers of the device are not disturbed.
+ */
+void EgoSmartHeaterSimulator::setTimeScale(uint16_t scale)
+{
+  _timeOffset = getTime();
+  _timeStart = millis();
+  _timeScale = (scale > 0) ? scale : 1;
+}
+
+unsigned long EgoSmartHeaterSimulator::getTime()
+{
+  return _timeOffset + (millis() - _timeStart) * _timeScale;
+}
+
+uint16_t EgoSmartHeaterSimulator::getRelaisStatus()
+{
+  return _relaisStatus;
+}
+
+float EgoSmartHeaterSimulator::getTemperatureBoiler()
+{
+  return _temperatureBoiler;
+}
+
+uint32_t EgoSmartHeaterSimulator::getRequestCount()
+{
+  return _requestCount;
+}
+
+uint32_t EgoSmartHeaterSimulator::getFaultCount(uint8_t fault)
+{
+  return (fault < EGO_SH_SIM_FAULT_TYPES) ? _faultCount[fault] : 0;
+}
+
+uint32_t EgoSmartHeaterSimulator::getKeepaliveMissCount()
+{
+  return _keepaliveMissCount;
+}
+
+//------------------------------------------------------------------------------
+// Modbus slave
+
+void EgoSmartHeaterSimulator::poll()
+{
+  if (_serial == NULL)
+    return;
+
+  // a long silence terminates a partial frame
+  if (_length > 0 && millis() - _lastByte > EGO_SH_SIM_FRAME_GAP)
+    _length = 0;
+
+  while (_serial->available() > 0)
+  {
+    int c = _serial->read();
+    if (c < 0)
+      break;
+    _lastByte = millis();
+    if (_length < sizeof(_frame))
+      _frame[_length++] = c;
+
+    size_t expected = getExpectedLength();
+    if (expected > 0 && _length >= expected)
+    {
+      if (EgoSmartHeaterModbusRtu::checkCrc(_frame, expected))
+        handleFrame();
+      _length = 0;
+    }
+  }
+  update();
+}
+
+/*
+ * The end of a frame is detected by its length, since the inter frame gap is not reliable on pseudo terminals and USB adapters.
+ * Returns 0 if the length is not known yet.
+ */
+size_t EgoSmartHeaterSimulator::getExpectedLength()
+{
+  if (_length < 2)
+    return 0;
+  switch (_frame[1])
+  {
+    case EGO_SH_MODBUS_FC_READ_HOLDING:
+      return 8;
+    case EGO_SH_MODBUS_FC_WRITE_MULTIPLE:
+      return (_length < 7) ? 0 : 9 + _frame[6];
+    default:
+      // unsupported function: 4 bytes of data is the common request size
+      return 8;
+  }
+}
+
+void EgoSmartHeaterSimulator::handleFrame()
+{
+  // broadcasts and requests to other slaves are ignored
+  if (_frame[0] != _slave)
+    return;
+  _requestCount++;
+
+  _fault = drawFault();
+  switch (_fault)
+  {
+    case EGO_SH_SIM_FAULT_REBOOT:
+      restart();
+      return;
+    case EGO_SH_SIM_FAULT_EXCEPTION2:
+      sendException(_frame[1], ModbusMaster::ku8MBIllegalDataAddress);
+      return;
+    case EGO_SH_SIM_FAULT_EXCEPTION3:
+      sendException(_frame[1], ModbusMaster::ku8MBIllegalDataValue);
+      return;
+  }
+
+  uint16_t reg = (_frame[2] << 8) | _frame[3];
+  uint16_t qty = (_frame[4] << 8) | _frame[5];
+
+  switch (_frame[1])
+  {
+    case EGO_SH_MODBUS_FC_READ_HOLDING:
+      handleRead(reg, qty);
+      break;
+    case EGO_SH_MODBUS_FC_WRITE_MULTIPLE:
+      handleWrite(reg, qty, &_frame[7]);
+      break;
+    default:
+      sendException(_frame[1], ModbusMaster::ku8MBIllegalFunction);
+      break;
+  }
+}
+
+void EgoSmartHeaterSimulator::handleRead(uint16_t reg, uint16_t qty)
+{
+  uint8_t response[EGO_SH_MODBUS_MAX_FRAME];
+  uint16_t value;
+
+  if (qty == 0 || qty > EGO_SH_MODBUS_MAX_READ)
+  {
+    sendException(EGO_SH_MODBUS_FC_READ_HOLDING, ModbusMaster::ku8MBIllegalDataValue);
+    return;
+  }
+
+  update();
+  response[0] = _slave;
+  response[1] = EGO_SH_MODBUS_FC_READ_HOLDING;
+  response[2] = qty * 2;
+  for (uint16_t i = 0; i < qty; i++)
+  {
+    if (!readRegister(reg + i, value))
+    {
+      sendException(EGO_SH_MODBUS_FC_READ_HOLDING, ModbusMaster::ku8MBIllegalDataAddress);
+      return;
+    }
+    response[3 + 2 * i] = value >> 8;
+    response[4 + 2 * i] = value & 0xFF;
+  }
+  send(response, 3 + qty * 2);
+}
+
+/*
+ * All values are checked before anything is written, so a refused request does not change the device state.
+ */
+void EgoSmartHeaterSimulator::handleWrite(uint16_t reg, uint16_t qty, const uint8_t *values)
+{
+  uint8_t response[8];
+
+  if (qty == 0 || qty > EGO_SH_MODBUS_MAX_WRITE || _frame[6] != qty * 2)
+  {
+    sendException(EGO_SH_MODBUS_FC_WRITE_MULTIPLE, ModbusMaster::ku8MBIllegalDataValue);
+    return;
+  }
+  for (uint16_t i = 0; i < qty; i++)
+  {
+    uint8_t code = checkWrite(reg + i, (values[2 * i] << 8) | values[2 * i + 1]);
+    if (code != ModbusMaster::ku8MBSuccess)
+    {
+      sendException(EGO_SH_MODBUS_FC_WRITE_MULTIPLE, code);
+      return;
+    }
+  }
+  for (uint16_t i = 0; i < qty; i++)
+  {
+    writeRegister(reg + i, (values[2 * i] << 8) | values[2 * i + 1]);
+  }
+  update();
+
+  memcpy(response, _frame, 6);
+  send(response, 6);
+}
+
+void EgoSmartHeaterSimulator::sendException(uint8_t function, uint8_t code)
+{
+  uint8_t response[5];
+
+  response[0] = _slave;
+  response[1] = function | 0x80;
+  response[2] = code;
+  send(response, 3);
+}
+
+void EgoSmartHeaterSimulator::send(uint8_t *frame, size_t len)
+{
+  len = EgoSmartHeaterModbusRtu::appendCrc(frame, len);
+  if (_fault == EGO_SH_SIM_FAULT_CRC)
+    frame[len - 1] ^= 0x5A;
+  else if (_fault == EGO_SH_SIM_FAULT_PARTIAL)
+    len /= 2;
+  _fault = EGO_SH_SIM_FAULT_NONE;
+  if (_responseDelay > 0)
+    delay(_responseDelay);
+  _serial->write(frame, len);
+  _serial->flush();
+}
+
+//------------------------------------------------------------------------------
+// Register map
+
+/*
+ * Strings are stored with the first character in the low byte of a register, see EgoSmartHeaterRS485::getModbusString32.
+ */
+uint16_t EgoSmartHeaterSimulator::getStringRegister(const char *text, uint16_t index)
+{
+  size_t len = strlen(text);
+  uint8_t low = ((size_t)2 * index < len) ? text[2 * index] : 0;
+  uint8_t high = ((size_t)2 * index + 1 < len) ? text[2 * index + 1] : 0;
+  return (high << 8) | low;
+}
+
+bool EgoSmartHeaterSimulator::readRegister(uint16_t reg, uint16_t &value)
+{
+  char serialNumber[EGO_SH_RS485_STRING_LEN + 1];
+
+  // relais configuration 0x1000, 0x1020, 0x1040
+  if (reg >= 0x1000 && reg < 0x1060 && (reg & 0x1F) < 7)
+  {
+    const RelaisConfigurationData_t &relais = _relais[(reg - 0x1000) >> 5];
+    switch (reg & 0x1F)
+    {
+      case 0: value = relais.ActualPower; break;
+      case 1: value = relais.OperatingSeconds >> 16; break;
+      case 2: value = relais.OperatingSeconds & 0xFFFF; break;
+      case 3: value = relais.SwitchingCycles >> 16; break;
+      case 4: value = relais.SwitchingCycles & 0xFFFF; break;
+      case 5: value = relais.MinOnTime; break;
+      case 6: value = relais.MinOffTime; break;
+    }
+    return true;
+  }
+  // relais operating time 0x1409 - 0x140E
+  if (reg >= 0x1409 && reg <= 0x140E)
+  {
+    uint32_t seconds = _relais[(reg - 0x1409) / 2].OperatingSeconds;
+    value = ((reg - 0x1409) % 2 == 0) ? seconds >> 16 : seconds & 0xFFFF;
+    return true;
+  }
+  // error log 0x1500 - 0x1527, no errors recorded
+  if (reg >= 0x1500 && reg < 0x1528)
+  {
+    value = 0;
+    return true;
+  }
+  // identity strings
+  if (reg >= 0x2004 && reg < 0x2014)
+  {
+    value = getStringRegister("E.G.O.", reg - 0x2004);
+    return true;
+  }
+  if (reg >= 0x2014 && reg < 0x2024)
+  {
+    value = getStringRegister("Smart Heater SM3500", reg - 0x2014);
+    return true;
+  }
+  if (reg >= 0x2024 && reg < 0x2034)
+  {
+    memcpy(serialNumber, _serialNumber, EGO_SH_RS485_STRING_LEN);
+    serialNumber[EGO_SH_RS485_STRING_LEN] = 0;
+    value = getStringRegister(serialNumber, reg - 0x2024);
+    return true;
+  }
+
+  switch (reg)
+  {
+    case 0x1202: value = _restartCounter >> 16; return true;
+    case 0x1203: value = _restartCounter & 0xFFFF; return true;
+    case 0x1204: value = 3; return true;
+    case 0x1205: value = 35; return true;
+    case 0x1209: value = _temperatureMinValue; return true;
+    case 0x120A: value = _temperatureMaxValue; return true;
+    case 0x120B: value = _temperatureNominalValue; return true;
+    case 0x1300: value = _powerNominalValue; return true;
+    case 0x1301: value = _homeTotalPower[0]; return true;
+    case 0x1302: value = _homeTotalPower[1]; return true;
+    case 0x1400: value = _totalOperatingSeconds >> 16; return true;
+    case 0x1401: value = _totalOperatingSeconds & 0xFFFF; return true;
+    case 0x1402: value = 0; return true;
+    case 0x1403: value = 0; return true;
+    case 0x1404: value = (int16_t)_temperatureBoiler; return true;
+    case 0x1405: value = 0x8001; return true;
+    case 0x1406: value = 0x8001; return true;
+    case 0x1407: value = _userTemperatureNominal; return true;
+    case 0x1408: value = _relaisStatus; return true;
+    case 0x2000: value = 0x14EF; return true;
+    case 0x2001: value = 0x0001; return true;
+    case 0x2002: value = 0x0001; return true;
+    case 0x2003: value = 100; return true;
+    case 0x2034: value = 0x2014; return true;
+    case 0x2035: value = 0x0515; return true;
+  }
+  return false;
+}
+
+/*
+ * Returns the exception code the device responds with if the value is written to the register.
+ */
+uint8_t EgoSmartHeaterSimulator::checkWrite(uint16_t reg, uint16_t value)
+{
+  if (reg >= 0x1000 && reg < 0x1060 && ((reg & 0x1F) == 5 || (reg & 0x1F) == 6))
+    return ModbusMaster::ku8MBSuccess;
+
+  switch (reg)
+  {
+    case 0x1209:
+      // 0 = Off, otherwise at least 10K below the potentiometer
+      if (value != 0 && (int16_t)value > _userTemperatureNominal - 10)
+        return ModbusMaster::ku8MBIllegalDataValue;
+      return ModbusMaster::ku8MBSuccess;
+    case 0x120A:
+      return ModbusMaster::ku8MBSuccess;
+    case 0x120B:
+      // 0 = potentiometer, otherwise not above the potentiometer
+      if (value != 0 && (int16_t)value > _userTemperatureNominal)
+        return ModbusMaster::ku8MBIllegalDataValue;
+      return ModbusMaster::ku8MBSuccess;
+    case 0x1300:
+      if ((int16_t)value < -1 || (int16_t)value > 3500)
+        return ModbusMaster::ku8MBIllegalDataValue;
+      return ModbusMaster::ku8MBSuccess;
+    case 0x1301:
+    case 0x1302:
+      return ModbusMaster::ku8MBSuccess;
+  }
+  return ModbusMaster::ku8MBIllegalDataAddress;
+}
+
+void EgoSmartHeaterSimulator::writeRegister(uint16_t reg, uint16_t value)
+{
+  if (reg >= 0x1000 && reg < 0x1060)
+  {
+    if ((reg & 0x1F) == 5)
+      _relais[(reg - 0x1000) >> 5].MinOnTime = value;
+    else
+      _relais[(reg - 0x1000) >> 5].MinOffTime = value;
+    return;
+  }
+
+  switch (reg)
+  {
+    case 0x1209: _temperatureMinValue = value; break;
+    case 0x120A: _temperatureMaxValue = value; break;
+    case 0x120B: _temperatureNominalValue = value; break;
+    case 0x1300:
+      _powerNominalValue = value;
+      _lastActivation = getTime();
+      _keepaliveMissed = false;
+      break;
+    case 0x1301:
+    case 0x1302:
+      _homeTotalPower[reg - 0x1301] = value;
+      _lastActivation = getTime();
+      _keepaliveMissed = false;
+      break;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Simulation
+
+void EgoSmartHeaterSimulator::update()
+{
+  unsigned long now = getTime();
+  int32_t target = 0;
+  int32_t current = 0;
+  int16_t nominal = (_temperatureNominalValue != 0) ? _temperatureNominalValue : _userTemperatureNominal;
+
+  for (int r = 0; r < 3; r++)
+  {
+    if (_relaisStatus & (1 << r))
+      current += _relais[r].ActualPower;
+  }
+
+  // requested power, only while the activation is renewed within the keepalive period
+  if (now - _lastActivation <= EGO_SH_SIM_KEEPALIVE)
+  {
+    if (_powerNominalValue >= 0)
+      target = _powerNominalValue;
+    else
+      target = current - (int32_t)(((uint32_t)_homeTotalPower[0] << 16) | _homeTotalPower[1]);
+  }
+  else if (_powerNominalValue != 0 && !_keepaliveMissed)
+  {
+    _keepaliveMissCount++;
+    _keepaliveMissed = true;
+  }
+  if (_temperatureBoiler >= nominal || _temperatureBoiler >= _temperatureMaxValue)
+    target = 0;
+  if (_temperatureMinValue != 0 && _temperatureBoiler < _temperatureMinValue)
+    target = 3500;
+  target = constrain(target, 0, 3500);
+
+  // switch the relais, respecting MinOnTime and MinOffTime
+  uint16_t desired = target / 500;
+  for (int r = 0; r < 3; r++)
+  {
+    uint16_t bit = 1 << r;
+    if ((desired & bit) == (_relaisStatus & bit))
+      continue;
+    uint16_t lockTime = (_relaisStatus & bit) ? _relais[r].MinOnTime : _relais[r].MinOffTime;
+    if (now - _relaisChanged[r] < 1000UL * lockTime)
+      continue;
+    _relaisStatus ^= bit;
+    _relais[r].SwitchingCycles++;
+    _relaisChanged[r] = now;
+  }
+
+  // counters and boiler temperature, advanced in steps of one second
+  while (now - _lastSecond >= 1000)
+  {
+    float power = 0;
+    _lastSecond += 1000;
+    _totalOperatingSeconds++;
+    for (int r = 0; r < 3; r++)
+    {
+      if (_relaisStatus & (1 << r))
+      {
+        _relais[r].OperatingSeconds++;
+        power += _relais[r].ActualPower;
+      }
+    }
+    _temperatureBoiler += power / BoilerCapacity - CoolingRate * (_temperatureBoiler - 20) / 40;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Fault injection
+
+/*
+ * Draws from a linear congruential generator, the rates of the faults are stacked in the range 0 - 9999.
+ */
+uint8_t EgoSmartHeaterSimulator::drawFault()
+{
+  _random = _random * 1103515245UL + 12345;
+  uint16_t value = (_random >> 16) % 10000;
+
+  for (uint8_t f = 0; f < EGO_SH_SIM_FAULT_TYPES; f++)
+  {
+    if (value < _faultRate[f])
+    {
+      _faultCount[f]++;
+      return f;
+    }
+    value -= _faultRate[f];
+  }
+  return EGO_SH_SIM_FAULT_NONE;
+}
+
+/*
+ * Like a power cycle of the device: the activation is lost and the relais are switched off. The configuration and the
+ * counters are kept, they are stored in the device.
+ */
+void EgoSmartHeaterSimulator::restart()
+{
+  _restartCounter++;
+  _powerNominalValue = 0;
+  _homeTotalPower[0] = 0;
+  _homeTotalPower[1] = 0;
+  _keepaliveMissed = false;
+  _relaisStatus = 0;
+  for (int r = 0; r < 3; r++)
+  {
+    _relaisChanged[r] = getTime() - 1000UL * _relais[r].MinOffTime;
+  }
+}
@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Simulated E.G.O. RS485 Smart Heater.
+ * Answers modbus RTU requests on a serial interface like a real device, for testing without hardware.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_SIMULATOR_h
+#define EGO_SH_SIMULATOR_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#include "EgoSmartHeaterModbusRtu.h"
+//------------------------------------------------------------------------------
+#define EGO_SH_SIM_KEEPALIVE 60000      // Activation timeout in milliseconds
+#define EGO_SH_SIM_FRAME_GAP 20         // Silence in milliseconds after which a partial frame is dropped
+
+// Faults injected by the simulated device, see setFaultRate()
+#define EGO_SH_SIM_FAULT_CRC 0          // response with a wrong CRC
+#define EGO_SH_SIM_FAULT_PARTIAL 1      // only the first half of the response is sent
+#define EGO_SH_SIM_FAULT_EXCEPTION2 2   // request refused with exception 2 (illegal data address)
+#define EGO_SH_SIM_FAULT_EXCEPTION3 3   // request refused with exception 3 (illegal data value)
+#define EGO_SH_SIM_FAULT_REBOOT 4       // the device restarts, the request is lost
+#define EGO_SH_SIM_FAULT_TYPES 5
+#define EGO_SH_SIM_FAULT_NONE 0xFF
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterSimulator
+/// Simulated Smart Heater (modbus slave). Provides all registers of the protocol description with the same
+/// access restrictions and exception codes as the device, switches the relais according to PowerNominalValue or
+/// HomeTotalPower including MinOnTime / MinOffTime and the 60 seconds keepalive, and heats a simulated boiler.
+/// Call poll() as often as possible.
+/// For soak tests the device can inject faults at given rates and run its clock faster than real time. The bus timing
+/// (frame gap, response delay) is not accelerated.
+class EgoSmartHeaterSimulator
+{
+public:
+  /// @brief Constructor to setup the simulated device.
+  /// @param slave is the modbus address the simulated device responds to (default: EGO_SH_RS485_MODBUS_ADR).
+  EgoSmartHeaterSimulator(uint8_t slave = EGO_SH_RS485_MODBUS_ADR);
+
+  /// @brief Attach the simulated device to a serial interface.
+  /// @param serial is the interface on which requests are received and answered.
+  void begin(Stream &serial);
+  /// @brief Process received requests and advance the simulation.
+  void poll();
+
+  /// @brief Configure the SerialNumber reported by the simulated device.
+  /// @param serialNumber is a string of up to 32 characters.
+  void setSerialNumber(const char *serialNumber);
+  /// @brief Configure the potentiometer position (UserTemperaturNominalValue).
+  /// @param value is the temperature in °C.
+  void setUserTemperatureNominal(int16_t value);
+  /// @brief Configure the boiler temperature.
+  /// @param value is the temperature in °C.
+  void setTemperatureBoiler(float value);
+  /// @brief Configure the processing time of the simulated device, e.g. to emulate the bus timing on pseudo terminals.
+  /// @param value is the delay in milliseconds before a response is sent (default: 0).
+  void setResponseDelay(uint16_t value);
+  /// @brief Configure the rate of an injected fault. At most one fault is injected per request, so the sum of all
+  /// rates should not exceed 10000. The faults are drawn from a fixed pseudo random sequence, so a run is repeatable.
+  /// @param fault is the type of the fault (EGO_SH_SIM_FAULT_CRC ... EGO_SH_SIM_FAULT_REBOOT).
+  /// @param rate is the number of faults per 10000 requests (default: 0).
+  void setFaultRate(uint8_t fault, uint16_t rate);
+  /// @brief Run the clock of the simulated device faster than real time, e.g. for the keepalive, the relais switching
+  /// times, the operating counters and the boiler temperature.
+  /// @param scale is the number of simulated milliseconds per real millisecond (default: 1).
+  void setTimeScale(uint16_t scale);
+
+  /// @return Current relais bitfield of the simulated device.
+  uint16_t getRelaisStatus();
+  /// @return Current boiler temperature of the simulated device in °C.
+  float getTemperatureBoiler();
+  /// @return Number of valid requests addressed to this device.
+  uint32_t getRequestCount();
+  /// @return Number of injected faults of a type.
+  /// @param fault is the type of the fault (EGO_SH_SIM_FAULT_CRC ... EGO_SH_SIM_FAULT_REBOOT).
+  uint32_t getFaultCount(uint8_t fault);
+  /// @return Number of activations (PowerNominalValue other than 0) which expired, since they were not renewed within
+  /// the keepalive period.
+  uint32_t getKeepaliveMissCount();
+  /// @return Time of the simulated device in milliseconds, equal to millis() without a time scale.
+  unsigned long getTime();
+
+protected:
+  Stream *_serial = NULL;
+  uint8_t _slave;
+  uint8_t _frame[EGO_SH_MODBUS_MAX_FRAME];
+  size_t _length = 0;
+  unsigned long _lastByte = 0;
+  unsigned long _lastSecond = 0;
+  unsigned long _lastActivation = 0;
+  uint32_t _requestCount = 0;
+  uint16_t _responseDelay = 0;
+  unsigned long _timeStart = 0;
+  unsigned long _timeOffset = 0;
+  uint16_t _timeScale = 1;
+
+  // fault injection
+  uint16_t _faultRate[EGO_SH_SIM_FAULT_TYPES];
+  uint32_t _faultCount[EGO_SH_SIM_FAULT_TYPES];
+  uint32_t _random = 1;
+  uint8_t _fault = EGO_SH_SIM_FAULT_NONE;
+  uint32_t _keepaliveMissCount = 0;
+  bool _keepaliveMissed = false;
+
+  // device state
+  char _serialNumber[EGO_SH_RS485_STRING_LEN];
+  uint32_t _restartCounter = 1;
+  uint32_t _totalOperatingSeconds = 0;
+  uint16_t _temperatureMinValue = 0;
+  uint16_t _temperatureMaxValue = 80;
+  uint16_t _temperatureNominalValue = 0;
+  int16_t _userTemperatureNominal = 60;
+  int16_t _powerNominalValue = 0;
+  uint16_t _homeTotalPower[2] = {0, 0};
+  uint16_t _relaisStatus = 0;
+  float _temperatureBoiler = 40;
+  RelaisConfigurationData_t _relais[3];
+  unsigned long _relaisChanged[3];
+
+  void handleFrame();
+  void handleRead(uint16_t reg, uint16_t qty);
+  void handleWrite(uint16_t reg, uint16_t qty, const uint8_t *values);
+  void sendException(uint8_t function, uint8_t code);
+  void send(uint8_t *frame, size_t len);
+  size_t getExpectedLength();
+
+  bool readRegister(uint16_t reg, uint16_t &value);
+  uint8_t checkWrite(uint16_t reg, uint16_t value);
+  void writeRegister(uint16_t reg, uint16_t value);
+  uint16_t getStringRegister(const char *text, uint16_t index);
+  void update();
+  uint8_t drawFault();
+  void restart();
+};
+
+#endif //EGO_SH_SIMULATOR_h
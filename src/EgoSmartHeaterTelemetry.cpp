@@ -0,0 +1,205 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Compact binary telemetry records for E.G.O. RS485 Smart Heaters, e.g. to be published by MQTT.
+ */
+
+//------------------------------------------------------------------------------
+#include "EgoSmartHeaterTelemetry.h"
+#if EGO_SH_FEATURE_TELEMETRY
+#include <Arduino.h>
+#include <stddef.h>
+
+#define TELEMETRY_FIELD(type, member) {offsetof(type, member), sizeof(((type *)0)->member)}
+#define RELAIS_FIELDS(r) \
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Relais[r].ActualPower), \
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Relais[r].OperatingSeconds), \
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Relais[r].SwitchingCycles), \
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Relais[r].MinOnTime), \
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Relais[r].MinOffTime)
+#define ERROR_FIELDS(i) \
+  TELEMETRY_FIELD(ErrorLog_t, Error[i].OperatingHour), \
+  TELEMETRY_FIELD(ErrorLog_t, Error[i].OperatingSecond), \
+  TELEMETRY_FIELD(ErrorLog_t, Error[i].ErrorCode)
+
+static const TelemetryField_t OperatingFields[] = {
+  TELEMETRY_FIELD(OperatingData_t, RestartCounter),
+  TELEMETRY_FIELD(OperatingData_t, TemperaturePCB),
+  TELEMETRY_FIELD(OperatingData_t, TotalOperatingSeconds),
+  TELEMETRY_FIELD(OperatingData_t, ErrorCounter),
+  TELEMETRY_FIELD(OperatingData_t, TemperatureBoiler),
+  TELEMETRY_FIELD(OperatingData_t, TemperatureExternalSensor1),
+  TELEMETRY_FIELD(OperatingData_t, TemperatureExternalSensor2),
+  TELEMETRY_FIELD(OperatingData_t, UserTemperatureNominal),
+  TELEMETRY_FIELD(OperatingData_t, RelaisStatus),
+  TELEMETRY_FIELD(OperatingData_t, OperatingTime.OperatingSeconds1),
+  TELEMETRY_FIELD(OperatingData_t, OperatingTime.OperatingSeconds2),
+  TELEMETRY_FIELD(OperatingData_t, OperatingTime.OperatingSeconds3)};
+
+static const TelemetryField_t ConfigFields[] = {
+  TELEMETRY_FIELD(TemperatureConfig_t, TemperatureMinValue),
+  TELEMETRY_FIELD(TemperatureConfig_t, TemperatureMaxValue),
+  TELEMETRY_FIELD(TemperatureConfig_t, TemperatureNominalValue)};
+
+static const TelemetryField_t RelaisFields[] = {
+  RELAIS_FIELDS(0), RELAIS_FIELDS(1), RELAIS_FIELDS(2),
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Valid[0]),
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Valid[1]),
+  TELEMETRY_FIELD(RelaisConfigurationSet_t, Valid[2])};
+
+static const TelemetryField_t ErrorLogFields[] = {
+  ERROR_FIELDS(0), ERROR_FIELDS(1), ERROR_FIELDS(2), ERROR_FIELDS(3), ERROR_FIELDS(4),
+  ERROR_FIELDS(5), ERROR_FIELDS(6), ERROR_FIELDS(7), ERROR_FIELDS(8), ERROR_FIELDS(9)};
+
+#define FIELD_COUNT(fields) (sizeof(fields) / sizeof(fields[0]))
+
+//------------------------------------------------------------------------------
+size_t EgoSmartHeaterTelemetry::encode(uint8_t *buffer, size_t size, uint8_t slave, const OperatingData_t &data, const OperatingData_t *previous)
+{
+  return encodeRecord(buffer, size, EGO_SH_TELEMETRY_OPERATING, slave, OperatingFields, FIELD_COUNT(OperatingFields), &data, previous);
+}
+
+size_t EgoSmartHeaterTelemetry::encode(uint8_t *buffer, size_t size, uint8_t slave, const TemperatureConfig_t &data, const TemperatureConfig_t *previous)
+{
+  return encodeRecord(buffer, size, EGO_SH_TELEMETRY_CONFIG, slave, ConfigFields, FIELD_COUNT(ConfigFields), &data, previous);
+}
+
+size_t EgoSmartHeaterTelemetry::encode(uint8_t *buffer, size_t size, uint8_t slave, const RelaisConfigurationSet_t &data, const RelaisConfigurationSet_t *previous)
+{
+  return encodeRecord(buffer, size, EGO_SH_TELEMETRY_RELAIS, slave, RelaisFields, FIELD_COUNT(RelaisFields), &data, previous);
+}
+
+size_t EgoSmartHeaterTelemetry::encode(uint8_t *buffer, size_t size, uint8_t slave, const ErrorLog_t &data, const ErrorLog_t *previous)
+{
+  return encodeRecord(buffer, size, EGO_SH_TELEMETRY_ERROR_LOG, slave, ErrorLogFields, FIELD_COUNT(ErrorLogFields), &data, previous);
+}
+
+size_t EgoSmartHeaterTelemetry::decode(const uint8_t *buffer, size_t len, OperatingData_t &data)
+{
+  return decodeRecord(buffer, len, EGO_SH_TELEMETRY_OPERATING, OperatingFields, FIELD_COUNT(OperatingFields), &data);
+}
+
+size_t EgoSmartHeaterTelemetry::decode(const uint8_t *buffer, size_t len, TemperatureConfig_t &data)
+{
+  return decodeRecord(buffer, len, EGO_SH_TELEMETRY_CONFIG, ConfigFields, FIELD_COUNT(ConfigFields), &data);
+}
+
+size_t EgoSmartHeaterTelemetry::decode(const uint8_t *buffer, size_t len, RelaisConfigurationSet_t &data)
+{
+  return decodeRecord(buffer, len, EGO_SH_TELEMETRY_RELAIS, RelaisFields, FIELD_COUNT(RelaisFields), &data);
+}
+
+size_t EgoSmartHeaterTelemetry::decode(const uint8_t *buffer, size_t len, ErrorLog_t &data)
+{
+  return decodeRecord(buffer, len, EGO_SH_TELEMETRY_ERROR_LOG, ErrorLogFields, FIELD_COUNT(ErrorLogFields), &data);
+}
+
+uint8_t EgoSmartHeaterTelemetry::getRecordType(const uint8_t *buffer)
+{
+  return buffer[0] & ~EGO_SH_TELEMETRY_DELTA;
+}
+
+uint8_t EgoSmartHeaterTelemetry::getSlaveId(const uint8_t *buffer)
+{
+  return buffer[1];
+}
+
+/*
+ * Fields are copied byte by byte from the structure in memory order of the host and written little endian, so the
+ * record has the same layout on every platform.
+ */
+size_t EgoSmartHeaterTelemetry::encodeRecord(uint8_t *buffer, size_t size, uint8_t type, uint8_t slave,
+                                             const TelemetryField_t *fields, uint8_t count, const void *data, const void *previous)
+{
+  const uint8_t *base = (const uint8_t *)data;
+  const uint8_t *last = (const uint8_t *)previous;
+  size_t bitmapSize = (count + 7) / 8;
+  size_t len = 2 + bitmapSize;
+  bool changed = false;
+
+  if (size < len)
+    return 0;
+  buffer[0] = (previous != NULL) ? (type | EGO_SH_TELEMETRY_DELTA) : type;
+  buffer[1] = slave;
+  memset(&buffer[2], 0, bitmapSize);
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    const uint8_t *field = base + fields[i].Offset;
+    uint32_t value = 0;
+
+    if (last != NULL && memcmp(field, last + fields[i].Offset, fields[i].Size) == 0)
+      continue;
+    if (len + fields[i].Size > size)
+      return 0;
+
+    switch (fields[i].Size)
+    {
+      case 1: { uint8_t v; memcpy(&v, field, 1); value = v; break; }
+      case 2: { uint16_t v; memcpy(&v, field, 2); value = v; break; }
+      default: { memcpy(&value, field, 4); break; }
+    }
+    for (uint8_t b = 0; b < fields[i].Size; b++)
+    {
+      buffer[len++] = value & 0xFF;
+      value >>= 8;
+    }
+    buffer[2 + i / 8] |= 1 << (i % 8);
+    changed = true;
+  }
+  return changed ? len : 0;
+}
+
+size_t EgoSmartHeaterTelemetry::decodeRecord(const uint8_t *buffer, size_t len, uint8_t type,
+                                             const TelemetryField_t *fields, uint8_t count, void *data)
+{
+  uint8_t *base = (uint8_t *)data;
+  size_t bitmapSize = (count + 7) / 8;
+  size_t pos = 2 + bitmapSize;
+  size_t end = pos;
+
+  if (len < pos || getRecordType(buffer) != type)
+    return 0;
+
+  // check the length first, a truncated record must not change the snapshot
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (buffer[2 + i / 8] & (1 << (i % 8)))
+      end += fields[i].Size;
+  }
+  if (end > len)
+    return 0;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint8_t *field = base + fields[i].Offset;
+    uint32_t value = 0;
+
+    if (!(buffer[2 + i / 8] & (1 << (i % 8))))
+      continue;
+
+    for (uint8_t b = 0; b < fields[i].Size; b++)
+    {
+      value |= (uint32_t)buffer[pos++] << (8 * b);
+    }
+    switch (fields[i].Size)
+    {
+      case 1: { uint8_t v = value; memcpy(field, &v, 1); break; }
+      case 2: { uint16_t v = value; memcpy(field, &v, 2); break; }
+      default: { memcpy(field, &value, 4); break; }
+    }
+  }
+  return pos;
+}
+
+#endif //EGO_SH_FEATURE_TELEMETRY
@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @author  Thomas Hock <th.hock@gmx.de>
+ * @version 1.0
+ *
+ * @section under MIT LICENSE
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @section DESCRIPTION
+ *
+ * Compact binary telemetry records for E.G.O. RS485 Smart Heaters, e.g. to be published by MQTT.
+ */
+
+//------------------------------------------------------------------------------
+#ifndef EGO_SH_TELEMETRY_h
+#define EGO_SH_TELEMETRY_h
+//------------------------------------------------------------------------------
+#include <Arduino.h>
+#include "EgoSmartHeaterRS485.h"
+#if EGO_SH_FEATURE_TELEMETRY
+//------------------------------------------------------------------------------
+#define EGO_SH_TELEMETRY_OPERATING 1      // Record type of OperatingData_t
+#define EGO_SH_TELEMETRY_CONFIG 2         // Record type of TemperatureConfig_t
+#define EGO_SH_TELEMETRY_RELAIS 3         // Record type of RelaisConfigurationSet_t
+#define EGO_SH_TELEMETRY_ERROR_LOG 4      // Record type of ErrorLog_t
+#define EGO_SH_TELEMETRY_DELTA 0x80       // Flag in the record type of a delta record
+#define EGO_SH_TELEMETRY_MAX_RECORD 96    // Maximum size of a record in bytes
+
+//------------------------------------------------------------------------------
+
+/// \struct TelemetryField_t
+/// position of a field within a snapshot structure
+struct TelemetryField_t
+{
+  uint8_t Offset;
+  uint8_t Size;
+};
+
+//------------------------------------------------------------------------------
+/// \class EgoSmartHeaterTelemetry
+/// Writes snapshot structures into a caller buffer as compact binary records and reads them back.
+/// A record consists of:
+/// - 1 byte record type, with EGO_SH_TELEMETRY_DELTA set for a delta record
+/// - 1 byte modbus address of the heater
+/// - a presence bitmap with one bit per field of the structure, least significant bit first
+/// - the present fields in the order of the structure, little endian with their native size
+/// A full record contains all fields. A delta record only contains the fields which differ from the previous snapshot,
+/// the receiver applies it to its copy of the previous snapshot. Several records can be concatenated in one message.
+/// No memory is allocated, the field layout is described by constant tables.
+class EgoSmartHeaterTelemetry
+{
+public:
+  /// @brief Encode operating information.
+  /// @param buffer receives the record.
+  /// @param size is the size of the buffer.
+  /// @param slave is the modbus address of the heater.
+  /// @param data is the snapshot to be encoded.
+  /// @param previous is the last published snapshot for a delta record (default: NULL = full record).
+  /// @return Size of the record in bytes, 0 if the buffer is too small or a delta record has no changed field.
+  static size_t encode(uint8_t *buffer, size_t size, uint8_t slave, const OperatingData_t &data, const OperatingData_t *previous = NULL);
+  /// @brief Encode the temperature configuration, see encode(OperatingData_t).
+  static size_t encode(uint8_t *buffer, size_t size, uint8_t slave, const TemperatureConfig_t &data, const TemperatureConfig_t *previous = NULL);
+  /// @brief Encode the configuration of all relais, see encode(OperatingData_t).
+  static size_t encode(uint8_t *buffer, size_t size, uint8_t slave, const RelaisConfigurationSet_t &data, const RelaisConfigurationSet_t *previous = NULL);
+  /// @brief Encode the error log, see encode(OperatingData_t).
+  static size_t encode(uint8_t *buffer, size_t size, uint8_t slave, const ErrorLog_t &data, const ErrorLog_t *previous = NULL);
+
+  /// @brief Decode operating information. Only the fields present in the record are written.
+  /// @param buffer contains the record.
+  /// @param len is the number of bytes available in the buffer.
+  /// @param data receives the fields.
+  /// @return Size of the record in bytes, 0 if the record is truncated or of another type.
+  static size_t decode(const uint8_t *buffer, size_t len, OperatingData_t &data);
+  /// @brief Decode the temperature configuration, see decode(OperatingData_t).
+  static size_t decode(const uint8_t *buffer, size_t len, TemperatureConfig_t &data);
+  /// @brief Decode the configuration of all relais, see decode(OperatingData_t).
+  static size_t decode(const uint8_t *buffer, size_t len, RelaisConfigurationSet_t &data);
+  /// @brief Decode the error log, see decode(OperatingData_t).
+  static size_t decode(const uint8_t *buffer, size_t len, ErrorLog_t &data);
+
+  /// @param buffer contains the record.
+  /// @return Record type without EGO_SH_TELEMETRY_DELTA.
+  static uint8_t getRecordType(const uint8_t *buffer);
+  /// @param buffer contains the record.
+  /// @return Modbus address of the heater.
+  static uint8_t getSlaveId(const uint8_t *buffer);
+
+protected:
+  static size_t encodeRecord(uint8_t *buffer, size_t size, uint8_t type, uint8_t slave, const TelemetryField_t *fields,
+                             uint8_t count, const void *data, const void *previous);
+  static size_t decodeRecord(const uint8_t *buffer, size_t len, uint8_t type, const TelemetryField_t *fields,
+                             uint8_t count, void *data);
+};
+
+#endif //EGO_SH_FEATURE_TELEMETRY
+#endif //EGO_SH_TELEMETRY_h